@@ -0,0 +1,410 @@
+#define _CRT_SECURE_NO_WARNINGS  // MSVC-specific for safe functions
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(_POSIX_C_SOURCE)
+    #define _POSIX_C_SOURCE 200112L  // clock_gettime
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MEMM_DONT_OVERRIDE_STD
+#include "memm.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#endif
+
+#ifdef MEMM_THREAD_SAFE
+    #if defined(_WIN32) || defined(_WIN64)
+        typedef HANDLE bench_thread_t;
+        #define BENCH_THREAD_RESULT DWORD WINAPI
+    #else
+        #include <pthread.h>
+        typedef pthread_t bench_thread_t;
+        #define BENCH_THREAD_RESULT void*
+    #endif
+#endif
+
+/// @brief how many free/malloc pairs are timed for every heap size
+#define BENCH_OPERATIONS 1000000
+
+/// @brief how many frees, then mallocs, are timed together so the clock reads don't weigh on single operations, must divide BENCH_OPERATIONS and not exceed the smallest heap
+#define BENCH_LOOKUP_BATCH 1000
+
+/// @brief size of every benchmarked block
+#define BENCH_BLOCK_SIZE 16
+
+/// @brief how many live blocks every thread of the scaling benchmark keeps
+#define BENCH_THREAD_LIVE 1024
+
+/// @brief how many free/malloc pairs every thread of the scaling benchmark issues
+#define BENCH_THREAD_OPERATIONS 200000
+
+/// @brief returns a monotonic timestamp in nanoseconds, unaffected by adjustments of the wall clock
+static double bench_now_ns(void)
+{
+    #if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+    #endif
+}
+
+/// @brief cheap pseudo-random generator, so the victims are not picked in allocation order
+static size_t bench_random(size_t* state)
+{
+    size_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/// @brief fills the heap with live blocks, then measures free and malloc of random victims while the live count stays constant
+static void bench_lookup(size_t live_count)
+{
+    void** blocks = (void**)malloc(live_count * sizeof(void*));
+    if (!blocks) {
+        printf("%12zu live: not enough memory\n", live_count);
+        return;
+    }
+
+    memm_init();
+    for (size_t i = 0; i < live_count; i++) {
+        blocks[i] = memm_malloc(BENCH_BLOCK_SIZE, __FILE__, __LINE__);
+    }
+
+    // a batch strides from a random start by a prime larger than the heap, so its victims are scattered and distinct
+    size_t state = 0x9E3779B97F4A7C15ull;
+    size_t* victims = (size_t*)malloc(BENCH_OPERATIONS * sizeof(size_t));
+    for (size_t i = 0; i < BENCH_OPERATIONS; i += BENCH_LOOKUP_BATCH) {
+        size_t first = bench_random(&state) % live_count;
+        for (size_t j = 0; j < BENCH_LOOKUP_BATCH; j++) {
+            victims[i + j] = (first + j * (size_t)2654435761u) % live_count;
+        }
+    }
+
+    double free_ns = 0.0;
+    double malloc_ns = 0.0;
+    for (size_t i = 0; i < BENCH_OPERATIONS; i += BENCH_LOOKUP_BATCH) {
+        const size_t* batch = victims + i;
+
+        double start = bench_now_ns();
+        for (size_t j = 0; j < BENCH_LOOKUP_BATCH; j++) {
+            memm_free(blocks[batch[j]], __FILE__, __LINE__);
+        }
+        double middle = bench_now_ns();
+        for (size_t j = 0; j < BENCH_LOOKUP_BATCH; j++) {
+            blocks[batch[j]] = memm_malloc(BENCH_BLOCK_SIZE, __FILE__, __LINE__);
+        }
+        double end = bench_now_ns();
+
+        free_ns += middle - start;
+        malloc_ns += end - middle;
+    }
+
+    printf("%12zu live: free %8.1f ns/op, malloc %8.1f ns/op", live_count, free_ns / BENCH_OPERATIONS, malloc_ns / BENCH_OPERATIONS);
+
+    memm_table_stats_t stats;
+    if (memm_get_table_stats(&stats)) {
+        printf(", probe avg %.2f max %zu (%s)", stats.average_probe_length, stats.max_probe_length, stats.hash_function);
+    }
+    printf("\n");
+
+    for (size_t i = 0; i < live_count; i++) {
+        memm_free(blocks[i], __FILE__, __LINE__);
+    }
+    memm_shutdown();
+
+    free(victims);
+    free(blocks);
+}
+
+/// @brief how many blocks every batch of the batch benchmark allocates
+#define BENCH_BATCH_SIZE 1000
+
+/// @brief how many batches the batch benchmark allocates and frees
+#define BENCH_BATCH_ROUNDS 1000
+
+/// @brief compares allocating and freeing nodes one call at a time against memm_malloc_batch/memm_free_batch
+static void bench_batch(void)
+{
+    void* blocks[BENCH_BATCH_SIZE];
+
+    memm_init();
+    double start = bench_now_ns();
+    for (size_t r = 0; r < BENCH_BATCH_ROUNDS; r++) {
+        for (size_t i = 0; i < BENCH_BATCH_SIZE; i++) {
+            blocks[i] = memm_malloc(BENCH_BLOCK_SIZE, __FILE__, __LINE__);
+        }
+        for (size_t i = 0; i < BENCH_BATCH_SIZE; i++) {
+            memm_free(blocks[i], __FILE__, __LINE__);
+        }
+    }
+    double single_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    for (size_t r = 0; r < BENCH_BATCH_ROUNDS; r++) {
+        memm_malloc_batch(BENCH_BLOCK_SIZE, BENCH_BATCH_SIZE, blocks, __FILE__, __LINE__);
+        memm_free_batch(blocks, BENCH_BATCH_SIZE);
+    }
+    double batch_ns = bench_now_ns() - start;
+    memm_shutdown();
+
+    double operations = (double)BENCH_BATCH_ROUNDS * BENCH_BATCH_SIZE;
+    printf("batches of %d blocks: single calls %8.1f ns/block, batch calls %8.1f ns/block\n", BENCH_BATCH_SIZE, single_ns / operations, batch_ns / operations);
+}
+
+/// @brief compares allocating and freeing same-sized nodes through memm_malloc/memm_free against a memm_pool_t
+static void bench_pool(void)
+{
+    void* blocks[BENCH_BATCH_SIZE];
+
+    memm_init();
+    double start = bench_now_ns();
+    for (size_t r = 0; r < BENCH_BATCH_ROUNDS; r++) {
+        for (size_t i = 0; i < BENCH_BATCH_SIZE; i++) {
+            blocks[i] = memm_malloc(BENCH_BLOCK_SIZE, __FILE__, __LINE__);
+        }
+        for (size_t i = 0; i < BENCH_BATCH_SIZE; i++) {
+            memm_free(blocks[i], __FILE__, __LINE__);
+        }
+    }
+    double malloc_ns = bench_now_ns() - start;
+
+    memm_pool_t* pool = memm_pool_create(BENCH_BLOCK_SIZE, 0, __FILE__, __LINE__);
+    start = bench_now_ns();
+    for (size_t r = 0; r < BENCH_BATCH_ROUNDS; r++) {
+        for (size_t i = 0; i < BENCH_BATCH_SIZE; i++) {
+            blocks[i] = memm_pool_alloc(pool);
+        }
+        for (size_t i = 0; i < BENCH_BATCH_SIZE; i++) {
+            memm_pool_free(pool, blocks[i]);
+        }
+    }
+    double pool_ns = bench_now_ns() - start;
+    memm_pool_destroy(pool);
+    memm_shutdown();
+
+    double operations = (double)BENCH_BATCH_ROUNDS * BENCH_BATCH_SIZE;
+    printf("%d byte objects: memm_malloc %8.1f ns/object, memm_pool_alloc %8.1f ns/object\n", BENCH_BLOCK_SIZE, malloc_ns / operations, pool_ns / operations);
+}
+
+/// @brief how many live blocks the small object benchmark keeps
+#define BENCH_SMALL_LIVE 10000
+
+/// @brief picks the size of a small object benchmark block, between 8 and 512 bytes
+#define BENCH_SMALL_SIZE(random) (8 + (random) % 505)
+
+/// @brief replaces random small blocks of mixed sizes through memm at a tracking level, or through the system allocator when track is false
+static double bench_small_run(void** blocks, const size_t* randoms, bool track, memm_level_t level)
+{
+    if (track) {
+        memm_set_level(level);
+        memm_init();
+    }
+
+    for (size_t i = 0; i < BENCH_SMALL_LIVE; i++) {
+        blocks[i] = track ? memm_malloc(BENCH_SMALL_SIZE(randoms[i]), __FILE__, __LINE__) : malloc(BENCH_SMALL_SIZE(randoms[i]));
+    }
+
+    double start = bench_now_ns();
+    for (size_t i = 0; i < BENCH_OPERATIONS; i++) {
+        size_t victim = randoms[i] % BENCH_SMALL_LIVE;
+        size_t size = BENCH_SMALL_SIZE(randoms[i] >> 20);
+        if (track) {
+            memm_free(blocks[victim], __FILE__, __LINE__);
+            blocks[victim] = memm_malloc(size, __FILE__, __LINE__);
+        }
+
+        else {
+            free(blocks[victim]);
+            blocks[victim] = malloc(size);
+        }
+    }
+    double elapsed = bench_now_ns() - start;
+
+    for (size_t i = 0; i < BENCH_SMALL_LIVE; i++) {
+        if (track) {
+            memm_free(blocks[i], __FILE__, __LINE__);
+        }
+
+        else {
+            free(blocks[i]);
+        }
+    }
+
+    if (track) {
+        memm_shutdown();
+        memm_set_level(MEMM_DEFAULT_LEVEL);
+    }
+    return elapsed / BENCH_OPERATIONS;
+}
+
+/// @brief compares a small-object-heavy workload on the system allocator and on memm at every tracking level, build with and without MEMM_SMALL_ALLOCATOR to compare backends
+static void bench_small(void)
+{
+    void** blocks = (void**)malloc(BENCH_SMALL_LIVE * sizeof(void*));
+    size_t* randoms = (size_t*)malloc(BENCH_OPERATIONS * sizeof(size_t));
+    if (!blocks || !randoms) {
+        free(blocks);
+        free(randoms);
+        return;
+    }
+
+    size_t state = 0x2545F4914F6CDD1Dull;
+    for (size_t i = 0; i < BENCH_OPERATIONS; i++) {
+        randoms[i] = bench_random(&state);
+    }
+
+    #ifdef MEMM_SMALL_ALLOCATOR
+    const char* backend = "size classes";
+    #else
+    const char* backend = "system allocator";
+    #endif
+    const char* levels[] = { "off:", "counters:", "callsites:", "full:" };
+
+    printf("small objects (%d live, 8..512 bytes, free/malloc pairs)\n", BENCH_SMALL_LIVE);
+    printf("  %-16s %8.1f ns/pair\n", "system malloc:", bench_small_run(blocks, randoms, false, MEMM_LEVEL_OFF));
+    for (int level = MEMM_LEVEL_OFF; level <= MEMM_LEVEL_FULL; level++) {
+        printf("  memm %-11s %8.1f ns/pair over %s\n", levels[level], bench_small_run(blocks, randoms, true, (memm_level_t)level), backend);
+    }
+
+    free(randoms);
+    free(blocks);
+}
+
+/// @brief size the growth benchmark starts its buffer at
+#define BENCH_GROWTH_START ((size_t)1 << 20)
+
+/// @brief size the growth benchmark stops growing its buffer at
+#define BENCH_GROWTH_END ((size_t)256 << 20)
+
+/// @brief grows a buffer by doubling it from BENCH_GROWTH_START to BENCH_GROWTH_END, returns the nanoseconds taken
+static double bench_growth_run(bool track)
+{
+    double start = bench_now_ns();
+    char* buffer = NULL;
+    for (size_t size = BENCH_GROWTH_START; size <= BENCH_GROWTH_END; size *= 2) {
+        char* grown = track ? (char*)memm_realloc(buffer, size, __FILE__, __LINE__) : (char*)realloc(buffer, size);
+        if (!grown) break;
+
+        // only the new half is written, what the old one holds must survive the growth
+        buffer = grown;
+        memset(buffer + size / 2, 1, size / 2);
+    }
+    if (track) memm_free(buffer, __FILE__, __LINE__);
+    else free(buffer);
+    return bench_now_ns() - start;
+}
+
+/// @brief compares growing a large buffer through the system realloc and memm_realloc, build with MEMM_MMAP_THRESHOLD to grow it by remapping
+static void bench_growth(void)
+{
+    #ifdef MEMM_MMAP_THRESHOLD
+    const char* backend = "mapped blocks";
+    #else
+    const char* backend = "system allocator";
+    #endif
+
+    printf("buffer growth (%zu MiB doubled up to %zu MiB)\n", BENCH_GROWTH_START >> 20, BENCH_GROWTH_END >> 20);
+    printf("  %-16s %8.2f ms\n", "system realloc:", bench_growth_run(false) / 1e6);
+
+    memm_init();
+    printf("  %-16s %8.2f ms over %s\n", "memm_realloc:", bench_growth_run(true) / 1e6, backend);
+    memm_shutdown();
+}
+
+#ifdef MEMM_THREAD_SAFE
+
+/// @brief keeps BENCH_THREAD_LIVE blocks alive while replacing random ones
+static BENCH_THREAD_RESULT bench_thread(void* arg)
+{
+    void* blocks[BENCH_THREAD_LIVE];
+    size_t state = (size_t)arg * 0x9E3779B97F4A7C15ull + 1;
+
+    for (size_t i = 0; i < BENCH_THREAD_LIVE; i++) {
+        blocks[i] = memm_malloc(BENCH_BLOCK_SIZE, __FILE__, __LINE__);
+    }
+
+    for (size_t i = 0; i < BENCH_THREAD_OPERATIONS; i++) {
+        size_t victim = bench_random(&state) % BENCH_THREAD_LIVE;
+        memm_free(blocks[victim], __FILE__, __LINE__);
+        blocks[victim] = memm_malloc(BENCH_BLOCK_SIZE, __FILE__, __LINE__);
+    }
+
+    for (size_t i = 0; i < BENCH_THREAD_LIVE; i++) {
+        memm_free(blocks[i], __FILE__, __LINE__);
+    }
+    return 0;
+}
+
+/// @brief runs the same per-thread workload on 1 to 32 threads, perfect scaling keeps the per-thread rate constant
+static void bench_scaling(void)
+{
+    const size_t counts[] = { 1, 2, 4, 8, 16, 32 };
+    bench_thread_t threads[32];
+
+    printf("thread scaling (%d shards, %d free/malloc pairs per thread)\n", MEMM_SHARD_COUNT, BENCH_THREAD_OPERATIONS);
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        memm_init();
+
+        double start = bench_now_ns();
+        for (size_t i = 0; i < counts[c]; i++) {
+            #if defined(_WIN32) || defined(_WIN64)
+            threads[i] = CreateThread(NULL, 0, bench_thread, (void*)(i + 1), 0, NULL);
+            #else
+            pthread_create(&threads[i], NULL, bench_thread, (void*)(i + 1));
+            #endif
+        }
+
+        for (size_t i = 0; i < counts[c]; i++) {
+            #if defined(_WIN32) || defined(_WIN64)
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+            #else
+            pthread_join(threads[i], NULL);
+            #endif
+        }
+        double elapsed = bench_now_ns() - start;
+
+        double total = (double)counts[c] * BENCH_THREAD_OPERATIONS * 2.0;
+        printf("%12zu threads: %8.2f Mops/s total, %8.2f Mops/s per thread\n", counts[c], total * 1e3 / elapsed, total * 1e3 / elapsed / (double)counts[c]);
+        memm_shutdown();
+    }
+}
+
+#endif
+
+int main(int argc, char** argv)
+{
+    // an optional argument caps the largest heap, 10M live blocks need around 1.5 GiB
+    size_t max_live = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : 10000000;
+    const size_t sizes[] = { 1000, 1000000, 10000000 };
+
+    printf("Memory Manager Benchmark\n");
+    printf("========================\n");
+    printf("pointer index lookup cost (%d byte blocks, %d operations)\n", BENCH_BLOCK_SIZE, BENCH_OPERATIONS);
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (sizes[i] <= max_live) {
+            bench_lookup(sizes[i]);
+        }
+    }
+
+    bench_batch();
+    bench_pool();
+    bench_small();
+    bench_growth();
+
+    #ifdef MEMM_THREAD_SAFE
+    bench_scaling();
+    #endif
+    return 0;
+}
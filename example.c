@@ -1,6 +1,9 @@
 #define _CRT_SECURE_NO_WARNINGS  // MSVC-specific for safe functions
 #include <stdio.h>
 #include <string.h>
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <unistd.h>
+#endif
 
 #define MEMM_ENABLE_LOGGING
 #define MEMM_MAX_STRING_LENGTH 2048
@@ -30,6 +33,15 @@ int main() {
     printf("===========================\n");
     
     test_function();
+
+    #if !defined(_WIN32) && !defined(_WIN64)
+    // blocks allocated inside libc are released untracked, memm never reads outside them to find out they aren't its own
+    char* cwd = getcwd(NULL, 0);
+    if (cwd) {
+        printf("Working directory: %s\n", cwd);
+        free(cwd);
+    }
+    #endif
     
     // method 1: using the buffer approach
     char buffer[MEMM_MAX_STRING_LENGTH];
@@ -45,29 +57,24 @@ int main() {
     if (memm_get_leaks_string(buffer, sizeof(buffer)) > 0) {
         printf("%s\n", buffer);
     }
+
+    if (memm_get_top_callsites_string(buffer, sizeof(buffer), 5, MEMM_SORT_TOTAL_BYTES) > 0) {
+        printf("%s\n", buffer);
+    }
     
-    // method 2: using the convenience macros, only works when MEMM_ENABLE_LOGGING is defined (and a good enough MEMM_MAX_STRING_LENGTH size)
+    // method 2: using the convenience macros, only works when MEMM_ENABLE_LOGGING is defined, they stream so nothing is truncated
     memm_print_stats();
     memm_print_allocations();
     memm_print_leaks();
+    memm_print_top_callsites(5, MEMM_SORT_LIVE_BYTES);
+    memm_print_lifetimes(5);
     
-    // method 3: writing to a file
+    // method 3: streaming to a file, no buffer to size and no truncation however many allocations are alive
     FILE* log_file = fopen("example_log.txt", "w");
     if (log_file) {
-        char file_buffer[MEMM_MAX_STRING_LENGTH];
-        
-        if (memm_get_stats_string(file_buffer, sizeof(file_buffer)) > 0) {
-            fprintf(log_file, "%s\n", file_buffer);
-        }
-        
-        if (memm_get_allocations_string(file_buffer, sizeof(file_buffer)) > 0) {
-            fprintf(log_file, "%s\n", file_buffer);
-        }
-    
-        if (memm_get_leaks_string(file_buffer, sizeof(file_buffer)) > 0) {
-            fprintf(log_file, "%s\n", file_buffer);
-        }
-        
+        memm_write_stats(memm_file_writer, log_file);
+        memm_write_allocations(memm_file_writer, log_file);
+        memm_write_leaks(memm_file_writer, log_file);
         fclose(log_file);
     }
     
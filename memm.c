@@ -1,402 +1,4810 @@
 #define _CRT_SECURE_NO_WARNINGS  // MSVC-specific for safe functions
+#if !defined(_WIN32) && !defined(_WIN64) && !defined(_GNU_SOURCE)
+    #define _GNU_SOURCE               // clock_gettime and CLOCK_MONOTONIC_COARSE under strict standard modes
+#endif
 #include "memm.h"
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <errno.h>
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+#if defined(_WIN32) || defined(_WIN64)
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
 
 /// @brief undefine macros to use real functions
 #undef malloc
 #undef calloc
 #undef realloc
 #undef free
+#undef free_sized
+#undef aligned_alloc
+#undef posix_memalign
+#undef memalign
+#undef valloc
+#undef strdup
+#undef strndup
+#undef reallocarray
+#undef asprintf
+#undef vasprintf
+#undef getline
+#undef getdelim
 #include <stdlib.h>
+#if defined(MEMM_SMALL_ALLOCATOR) || defined(MEMM_MMAP_THRESHOLD)
+    #if defined(_WIN32) || defined(_WIN64)
+        #define WIN32_LEAN_AND_MEAN
+        #include <windows.h>
+    #else
+        #include <sys/mman.h>
+    #endif
+#endif
+#ifdef MEMM_SAMPLING
+    #include <math.h>
+    #if defined(_WIN32) || defined(_WIN64)
+        #include <malloc.h>
+        #define memm_usable_size(ptr) _msize(ptr)
+    #elif defined(__APPLE__)
+        #include <malloc/malloc.h>
+        #define memm_usable_size(ptr) malloc_size(ptr)
+    #else
+        #include <malloc.h>
+        #define memm_usable_size(ptr) malloc_usable_size(ptr)
+    #endif
+#endif
+
+/// @brief the allocator underneath memm, the preload build points it at the definitions its own ones interpose
+#ifdef MEMM_PRELOAD
+    static void* memm_libc_malloc(size_t size);
+    static void* memm_libc_calloc(size_t num, size_t size);
+    static void* memm_libc_realloc(void* ptr, size_t size);
+    static void memm_libc_free(void* ptr);
+    static int memm_libc_posix_memalign(void** ptr, size_t alignment, size_t size);
+#else
+    #define memm_libc_malloc(size) malloc(size)
+    #define memm_libc_calloc(num, size) calloc(num, size)
+    #define memm_libc_realloc(ptr, size) realloc(ptr, size)
+    #define memm_libc_free(ptr) free(ptr)
+    #define memm_libc_posix_memalign(ptr, alignment, size) posix_memalign(ptr, alignment, size)
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// Synchronization
+
+#ifdef MEMM_THREAD_SAFE
+    #if defined(_WIN32) || defined(_WIN64)
+        #define WIN32_LEAN_AND_MEAN
+        #include <windows.h>
+        typedef SRWLOCK memm_lock_t;
+        #define MEMM_LOCK_INITIALIZER SRWLOCK_INIT
+        #define MEMM_THREAD_LOCAL __declspec(thread)
+        #define memm_lock_init(lock) InitializeSRWLock(lock)
+        #define memm_lock_acquire(lock) AcquireSRWLockExclusive(lock)
+        #define memm_lock_release(lock) ReleaseSRWLockExclusive(lock)
+        #define memm_atomic_add(target, value) ((size_t)InterlockedExchangeAddSizeT((volatile SIZE_T*)(target), (SIZE_T)(value)))
+        #define memm_atomic_add_release(target, value) ((size_t)InterlockedExchangeAddSizeT((volatile SIZE_T*)(target), (SIZE_T)(value)))
+        #define memm_atomic_load(target) (*(volatile size_t*)(target))
+        #define memm_atomic_store(target, value) (*(volatile size_t*)(target) = (value))
+        // msvc gives volatile accesses acquire and release semantics (/volatile:ms, the default on x86 and x64)
+        #define memm_atomic_load_acquire(target) (*(volatile size_t*)(target))
+        #define memm_atomic_store_release(target, value) (*(volatile size_t*)(target) = (value))
+        #define memm_atomic_cas(target, expected, desired) (InterlockedCompareExchangePointer((volatile PVOID*)(target), (PVOID)(desired), (PVOID)(expected)) == (PVOID)(expected))
+    #else
+        #include <pthread.h>
+        typedef pthread_mutex_t memm_lock_t;
+        #define MEMM_LOCK_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+        #define MEMM_THREAD_LOCAL __thread
+        #define memm_lock_init(lock) pthread_mutex_init(lock, NULL)
+        #define memm_lock_acquire(lock) pthread_mutex_lock(lock)
+        #define memm_lock_release(lock) pthread_mutex_unlock(lock)
+        #define memm_atomic_add(target, value) __atomic_fetch_add(target, value, __ATOMIC_RELAXED)
+        #define memm_atomic_add_release(target, value) __atomic_fetch_add(target, value, __ATOMIC_RELEASE)
+        #define memm_atomic_load(target) __atomic_load_n(target, __ATOMIC_RELAXED)
+        #define memm_atomic_store(target, value) __atomic_store_n(target, value, __ATOMIC_RELAXED)
+        #define memm_atomic_load_acquire(target) __atomic_load_n(target, __ATOMIC_ACQUIRE)
+        #define memm_atomic_store_release(target, value) __atomic_store_n(target, value, __ATOMIC_RELEASE)
+        #define memm_atomic_cas(target, expected, desired) __atomic_compare_exchange_n(target, &(expected), desired, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+    #endif
+#else
+    typedef int memm_lock_t;
+    #define MEMM_LOCK_INITIALIZER 0
+    #define MEMM_THREAD_LOCAL
+    #define memm_lock_init(lock) ((void)(lock))
+    #define memm_lock_acquire(lock) ((void)(lock))
+    #define memm_lock_release(lock) ((void)(lock))
+    #define memm_atomic_add(target, value) memm_plain_add(target, value)
+    #define memm_atomic_add_release(target, value) memm_plain_add(target, value)
+    #define memm_atomic_load(target) (*(target))
+    #define memm_atomic_store(target, value) (*(target) = (value))
+    #define memm_atomic_load_acquire(target) (*(target))
+    #define memm_atomic_store_release(target, value) (*(target) = (value))
+    #define memm_atomic_cas(target, expected, desired) (*(target) = (desired), true)
+#endif
+
+#ifndef MEMM_THREAD_SAFE
+/// @brief adds value to target returning the previous value, like the atomic variants
+static size_t memm_plain_add(size_t* target, size_t value)
+{
+    size_t previous = *target;
+    *target += value;
+    return previous;
+}
+#endif
+
+/// @brief raises target to value if it is lower, racing writers may only raise it further
+static void memm_atomic_max(size_t* target, size_t value)
+{
+    size_t current = memm_atomic_load(target);
+    while (value > current && !memm_atomic_cas(target, current, value)) {
+        current = memm_atomic_load(target);
+    }
+}
+
+/// @brief returns how many bits are needed to represent value, 0 for 0
+static inline unsigned memm_bit_length(uint64_t value)
+{
+    #if defined(_MSC_VER)
+    unsigned long index;
+    return _BitScanReverse64(&index, value) ? (unsigned)index + 1 : 0;
+    #else
+    return value ? 64 - (unsigned)__builtin_clzll(value) : 0;
+    #endif
+}
+
+/// @brief returns the size class of a size, sizes below MEMM_SIZE_SUB_BUCKETS get their own then every power of two is split into MEMM_SIZE_SUB_BUCKETS
+static inline size_t memm_size_class(size_t size)
+{
+    unsigned bits = memm_bit_length(size);
+    if (bits <= MEMM_SIZE_SUB_BUCKET_BITS) return size;
+    if (bits > MEMM_SIZE_HISTOGRAM_BITS) return MEMM_SIZE_BUCKETS - 1;
+
+    // the bits right below the leading one pick the sub-bucket
+    unsigned shift = bits - 1 - MEMM_SIZE_SUB_BUCKET_BITS;
+    return ((size_t)(bits - MEMM_SIZE_SUB_BUCKET_BITS) << MEMM_SIZE_SUB_BUCKET_BITS) + ((size >> shift) & (MEMM_SIZE_SUB_BUCKETS - 1));
+}
+
+/// @brief returns the smallest size of a size class
+static uint64_t memm_size_class_lower_bound(size_t size_class)
+{
+    if (size_class < MEMM_SIZE_SUB_BUCKETS) return size_class;
+
+    unsigned power = (unsigned)(size_class >> MEMM_SIZE_SUB_BUCKET_BITS) + MEMM_SIZE_SUB_BUCKET_BITS - 1;
+    uint64_t sub_bucket = size_class & (MEMM_SIZE_SUB_BUCKETS - 1);
+    return ((uint64_t)1 << power) + (sub_bucket << (power - MEMM_SIZE_SUB_BUCKET_BITS));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// Clock
+
+#if MEMM_CLOCK_SOURCE == MEMM_CLOCK_CYCLES
+    #if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        #if defined(_MSC_VER)
+            #include <intrin.h>
+        #else
+            #include <x86intrin.h>
+        #endif
+        #define MEMM_CLOCK_CALIBRATED // tsc frequency isn't exposed, it is measured against the monotonic clock
+    #elif !defined(__aarch64__) || defined(_MSC_VER)
+        #undef MEMM_CLOCK_SOURCE
+        #define MEMM_CLOCK_SOURCE MEMM_CLOCK_COARSE
+    #endif
+#endif
+
+#if (defined(_WIN32) || defined(_WIN64)) && MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#endif
+
+#if defined(CLOCK_MONOTONIC_COARSE)
+    #define MEMM_COARSE_CLOCK_ID CLOCK_MONOTONIC_COARSE
+#else
+    #define MEMM_COARSE_CLOCK_ID CLOCK_MONOTONIC
+#endif
+
+/// @brief how long the cycle counter is measured against the monotonic clock before converting, at least
+#define MEMM_CLOCK_CALIBRATION_NS 1000000
+
+/// @brief reads the clock allocations are timestamped with, in ticks of the configured source
+static inline uint64_t memm_clock_ticks()
+{
+    #if MEMM_CLOCK_SOURCE == MEMM_CLOCK_CYCLES && defined(MEMM_CLOCK_CALIBRATED)
+    return __rdtsc();
+    #elif MEMM_CLOCK_SOURCE == MEMM_CLOCK_CYCLES
+    uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+    #elif MEMM_CLOCK_SOURCE == MEMM_CLOCK_COARSE && (defined(_WIN32) || defined(_WIN64))
+    return GetTickCount64();
+    #elif MEMM_CLOCK_SOURCE == MEMM_CLOCK_COARSE
+    struct timespec ts;
+    clock_gettime(MEMM_COARSE_CLOCK_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    #else
+    return 0;
+    #endif
+}
+
+#ifdef MEMM_CLOCK_CALIBRATED
+/// @brief reads the precise monotonic clock in nanoseconds, only used to calibrate the cycle counter
+static uint64_t memm_clock_reference_ns()
+{
+    #if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+    #else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+    #endif
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// Small Object Heap
+
+#ifdef MEMM_SMALL_ALLOCATOR
+
+/// @brief size classes, one per multiple of 16 bytes up to MEMM_SMALL_MAX_SIZE
+#define MEMM_SMALL_CLASSES (MEMM_SMALL_MAX_SIZE / 16)
+
+/// @brief slab pages the reserved address space is split into
+#define MEMM_SMALL_PAGES (MEMM_SMALL_HEAP_SIZE / MEMM_SMALL_PAGE_SIZE)
+
+/// @brief largest alignment every block of a suitable size class has, the reservation is only aligned to an os page
+#if MEMM_SMALL_PAGE_SIZE < 4096
+    #define MEMM_SMALL_MAX_ALIGNMENT MEMM_SMALL_PAGE_SIZE
+#else
+    #define MEMM_SMALL_MAX_ALIGNMENT 4096
+#endif
+
+/// @brief shared state of a size class, padded so neighbour class locks don't share a cache line
+typedef struct memm_small_class
+{
+    memm_lock_t lock;
+    void* free_list;            // blocks handed back by thread caches, linked through their first bytes
+    char* bump;                 // next never-used block of the newest page of the class
+    char* bump_end;             // end of the last whole block of that page
+    size_t high_water;          // blocks a thread cache may hold, half of them move to or from the class at once
+    char padding[64];
+} memm_small_class_t;
+
+/// @brief blocks of a size class cached by a thread, taken and returned without locking
+typedef struct memm_small_cache
+{
+    void* head;
+    size_t count;               // only the owner writes it, stats read it concurrently
+} memm_small_cache_t;
+
+/// @brief the caches of a thread, registered so the stats can sum them and reused once the thread exits
+typedef struct memm_small_thread
+{
+    memm_small_cache_t caches[MEMM_SMALL_CLASSES];
+    size_t flushes;             // batches handed back to the size classes
+    bool idle;                  // the thread exited, the block waits for a new one
+    struct memm_small_thread* next; // next block in the registry
+} memm_small_thread_t;
+
+/// @brief the slab page heap, pages are carved in order from a single reservation so a range check tells its blocks apart
+typedef struct memm_small_heap
+{
+    size_t base;                // address of the reservation, 0 until the first small request
+    bool failed;                // the reservation was refused, every request goes to the system allocator
+    size_t pages_used;          // pages handed to size classes, may overshoot MEMM_SMALL_PAGES once exhausted
+    uint8_t page_classes[MEMM_SMALL_PAGES]; // size class of every page handed out
+    memm_small_class_t classes[MEMM_SMALL_CLASSES];
+    memm_small_thread_t* threads; // every thread caches block ever created, guarded by g_memm_small_lock
+    size_t reclaimed;           // caches drained when their thread exited
+    #ifdef MEMM_THREAD_SAFE
+    #if defined(_WIN32) || defined(_WIN64)
+    DWORD exit_key;             // fiber local storage slot whose callback drains the caches of exiting threads
+    #else
+    pthread_key_t exit_key;     // thread specific key whose destructor drains the caches of exiting threads
+    #endif
+    #endif
+} memm_small_heap_t;
+
+/// @brief small object heap, it outlives memm_init/memm_shutdown since its blocks may still be alive
+static memm_small_heap_t g_memm_small;
+
+/// @brief guards the reservation of the small object heap and its thread registry
+static memm_lock_t g_memm_small_lock = MEMM_LOCK_INITIALIZER;
+
+/// @brief caches of the calling thread, created on its first small request
+static MEMM_THREAD_LOCAL memm_small_thread_t* t_memm_small_thread = NULL;
+
+/// @brief returns the size class of a request no larger than MEMM_SMALL_MAX_SIZE, zero-sized requests take the smallest
+static inline size_t memm_small_class(size_t size)
+{
+    return size ? (size - 1) >> 4 : 0;
+}
+
+/// @brief returns the size of the blocks of a size class
+static inline size_t memm_small_class_size(size_t size_class)
+{
+    return (size_class + 1) << 4;
+}
+
+/// @brief returns the page offset of a block if it belongs to the small heap, or MEMM_SMALL_HEAP_SIZE otherwise
+static inline size_t memm_small_offset(const void* ptr)
+{
+    size_t base = memm_atomic_load(&g_memm_small.base);
+    size_t offset = (size_t)ptr - base;
+    return base && offset < MEMM_SMALL_HEAP_SIZE ? offset : MEMM_SMALL_HEAP_SIZE;
+}
+
+#ifdef MEMM_THREAD_SAFE
+static void memm_small_thread_exit(void* thread);
+
+#if defined(_WIN32) || defined(_WIN64)
+/// @brief fiber local storage callback, called with the caches of a thread when it exits
+static VOID WINAPI memm_small_fls_exit(PVOID thread)
+{
+    if (thread) memm_small_thread_exit(thread);
+}
+#endif
+#endif
+
+/// @brief reserves the address space of the heap once, returns false if it is unavailable
+static bool memm_small_reserve()
+{
+    // the class locks are initialized before the base is published
+    if (memm_atomic_load_acquire(&g_memm_small.base)) return true;
+
+    memm_lock_acquire(&g_memm_small_lock);
+    if (!g_memm_small.base && !g_memm_small.failed) {
+        #if defined(_WIN32) || defined(_WIN64)
+        // pages are committed one at a time as size classes take them
+        void* base = VirtualAlloc(NULL, MEMM_SMALL_HEAP_SIZE, MEM_RESERVE, PAGE_NOACCESS);
+        #else
+        // untouched pages take no physical memory
+        void* base = mmap(NULL, MEMM_SMALL_HEAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (base == MAP_FAILED) base = NULL;
+        #endif
+
+        // without thread exit notifications the caches of exited threads would be lost
+        #ifdef MEMM_THREAD_SAFE
+        #if defined(_WIN32) || defined(_WIN64)
+        if (base && (g_memm_small.exit_key = FlsAlloc(memm_small_fls_exit)) == FLS_OUT_OF_INDEXES) {
+            VirtualFree(base, 0, MEM_RELEASE);
+            base = NULL;
+        }
+        #else
+        if (base && pthread_key_create(&g_memm_small.exit_key, memm_small_thread_exit) != 0) {
+            munmap(base, MEMM_SMALL_HEAP_SIZE);
+            base = NULL;
+        }
+        #endif
+        #endif
+
+        if (base) {
+            for (size_t i = 0; i < MEMM_SMALL_CLASSES; i++) {
+                // large classes cache fewer blocks, so a thread holds at most about MEMM_SMALL_CACHE_BYTES per class
+                size_t high_water = MEMM_SMALL_CACHE_BYTES / memm_small_class_size(i);
+                high_water = high_water < MEMM_SMALL_CACHE_SIZE ? high_water : MEMM_SMALL_CACHE_SIZE;
+                g_memm_small.classes[i].high_water = high_water < 2 ? 2 : high_water;
+                memm_lock_init(&g_memm_small.classes[i].lock);
+            }
+            memm_atomic_store_release(&g_memm_small.base, (size_t)base);
+        }
+
+        else {
+            g_memm_small.failed = true;
+        }
+    }
+    memm_lock_release(&g_memm_small_lock);
+    return memm_atomic_load(&g_memm_small.base) != 0;
+}
+
+/// @brief returns the caches of the calling thread, taking over those of an exited thread when there is one
+static memm_small_thread_t* memm_small_thread()
+{
+    memm_small_thread_t* thread = t_memm_small_thread;
+    if (thread) return thread;
+    if (!memm_small_reserve()) return NULL;
+
+    memm_lock_acquire(&g_memm_small_lock);
+    for (thread = g_memm_small.threads; thread && !thread->idle; thread = thread->next);
+    if (thread) {
+        thread->idle = false;
+    }
+
+    else if ((thread = (memm_small_thread_t*)memm_libc_calloc(1, sizeof(memm_small_thread_t))) != NULL) {
+        // blocks are never released, the stats keep walking them
+        thread->next = g_memm_small.threads;
+        g_memm_small.threads = thread;
+    }
+    memm_lock_release(&g_memm_small_lock);
+    if (!thread) return NULL;
+
+    #ifdef MEMM_THREAD_SAFE
+    #if defined(_WIN32) || defined(_WIN64)
+    FlsSetValue(g_memm_small.exit_key, thread);
+    #else
+    pthread_setspecific(g_memm_small.exit_key, thread);
+    #endif
+    #endif
+    t_memm_small_thread = thread;
+    return thread;
+}
+
+/// @brief hands a fresh page to a size class whose lock is held, returns false once the heap is used up
+static bool memm_small_add_page(memm_small_class_t* class_state, size_t size_class)
+{
+    if (memm_atomic_load(&g_memm_small.pages_used) >= MEMM_SMALL_PAGES) return false;
+
+    size_t page = memm_atomic_add(&g_memm_small.pages_used, 1);
+    if (page >= MEMM_SMALL_PAGES) return false;
+
+    char* start = (char*)memm_atomic_load(&g_memm_small.base) + page * MEMM_SMALL_PAGE_SIZE;
+    #if defined(_WIN32) || defined(_WIN64)
+    if (!VirtualAlloc(start, MEMM_SMALL_PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE)) return false;
+    #endif
+
+    size_t block_size = memm_small_class_size(size_class);
+    g_memm_small.page_classes[page] = (uint8_t)size_class;
+    class_state->bump = start;
+    class_state->bump_end = start + MEMM_SMALL_PAGE_SIZE / block_size * block_size;
+    return true;
+}
+
+/// @brief refills an empty thread cache with half its high-water mark, returning one block to the caller or NULL once the heap is used up
+static void* memm_small_refill(memm_small_cache_t* cache, size_t size_class)
+{
+    memm_small_class_t* class_state = &g_memm_small.classes[size_class];
+    size_t block_size = memm_small_class_size(size_class);
+    size_t batch = class_state->high_water / 2;
+    void* head = NULL;
+    size_t count = 0;
+
+    memm_lock_acquire(&class_state->lock);
+    while (count < batch && class_state->free_list) {
+        void* block = class_state->free_list;
+        class_state->free_list = *(void**)block;
+        *(void**)block = head;
+        head = block;
+        count++;
+    }
+
+    while (count < batch) {
+        if (class_state->bump == class_state->bump_end && !memm_small_add_page(class_state, size_class)) break;
+
+        void* block = class_state->bump;
+        class_state->bump += block_size;
+        *(void**)block = head;
+        head = block;
+        count++;
+    }
+    memm_lock_release(&class_state->lock);
+
+    if (!head) return NULL;
+
+    cache->head = *(void**)head;
+    memm_atomic_store(&cache->count, count - 1);
+    return head;
+}
+
+/// @brief hands count blocks from the top of a thread cache back to their size class in a single splice
+static void memm_small_flush(memm_small_thread_t* thread, size_t size_class, size_t count)
+{
+    memm_small_cache_t* cache = &thread->caches[size_class];
+    void* first = cache->head;
+    void* last = first;
+    for (size_t i = 1; i < count; i++) {
+        last = *(void**)last;
+    }
+    cache->head = *(void**)last;
+    memm_atomic_store(&cache->count, cache->count - count);
+    memm_atomic_store(&thread->flushes, thread->flushes + 1);
+
+    memm_small_class_t* class_state = &g_memm_small.classes[size_class];
+    memm_lock_acquire(&class_state->lock);
+    *(void**)last = class_state->free_list;
+    class_state->free_list = first;
+    memm_lock_release(&class_state->lock);
+}
+
+#ifdef MEMM_THREAD_SAFE
+/// @brief drains the caches of an exiting thread back to the size classes and leaves them for the next thread
+static void memm_small_thread_exit(void* thread)
+{
+    memm_small_thread_t* caches = (memm_small_thread_t*)thread;
+    for (size_t i = 0; i < MEMM_SMALL_CLASSES; i++) {
+        if (caches->caches[i].count) {
+            memm_small_flush(caches, i, caches->caches[i].count);
+        }
+    }
+
+    // destructors running later on this thread may still allocate, they pick a block again
+    t_memm_small_thread = NULL;
+    memm_lock_acquire(&g_memm_small_lock);
+    caches->idle = true;
+    g_memm_small.reclaimed++;
+    memm_lock_release(&g_memm_small_lock);
+}
+#endif
+
+/// @brief takes a block of a size class, from the thread cache when it has one
+static inline void* memm_small_malloc(size_t size_class)
+{
+    memm_small_thread_t* thread = memm_small_thread();
+    if (!thread) return NULL;
+
+    memm_small_cache_t* cache = &thread->caches[size_class];
+    void* block = cache->head;
+    if (block) {
+        cache->head = *(void**)block;
+        memm_atomic_store(&cache->count, cache->count - 1);
+        return block;
+    }
+    return memm_small_refill(cache, size_class);
+}
+
+/// @brief returns a block at a page offset of the heap to the thread cache, handing half of it back once it reaches its high-water mark
+static inline void memm_small_free(void* ptr, size_t offset)
+{
+    size_t size_class = g_memm_small.page_classes[offset / MEMM_SMALL_PAGE_SIZE];
+    memm_small_thread_t* thread = memm_small_thread();
+    if (!thread) {
+        // the caches of this thread couldn't be allocated, the block goes straight back to its class
+        memm_small_class_t* class_state = &g_memm_small.classes[size_class];
+        memm_lock_acquire(&class_state->lock);
+        *(void**)ptr = class_state->free_list;
+        class_state->free_list = ptr;
+        memm_lock_release(&class_state->lock);
+        return;
+    }
+
+    memm_small_cache_t* cache = &thread->caches[size_class];
+    *(void**)ptr = cache->head;
+    cache->head = ptr;
+    memm_atomic_store(&cache->count, cache->count + 1);
+    size_t high_water = g_memm_small.classes[size_class].high_water;
+    if (cache->count >= high_water) {
+        memm_small_flush(thread, size_class, high_water / 2);
+    }
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// Pointer Sets
+
+#if defined(MEMM_INLINE_HEADERS) || defined(MEMM_MMAP_THRESHOLD)
+
+/// @brief slots a shard of a pointer set starts with, must be a power of 2
+#define MEMM_PTR_SET_SIZE 64
+
+/// @brief independently locked part of a pointer set
+typedef struct memm_ptr_shard
+{
+    memm_lock_t lock;
+    void** slots;         // open addressing, NULL marks an empty slot
+    size_t capacity;            // slots, power of 2, 0 until the first insertion
+    unsigned bits;              // log2 of capacity
+    size_t count;
+    char padding[64];           // keeps neighbour shard locks off the same cache line
+} memm_ptr_shard_t;
+
+/// @brief exact set of the blocks memm owns, sharded like the pointer index, its locks start zeroed like those of g_memm
+typedef struct memm_ptr_set
+{
+    size_t count;               // pointers in every shard, read without locking so an empty set is skipped
+    memm_ptr_shard_t shards[MEMM_SHARD_COUNT];
+} memm_ptr_set_t;
+
+/// @brief spreads a pointer, the shard is picked from the middle bits and the slot from the top ones
+static uint64_t memm_ptr_set_hash(void* ptr)
+{
+    return (uint64_t)(uintptr_t)ptr * 11400714819323198485ull;
+}
+
+/// @brief returns the shard a pointer belongs to
+static memm_ptr_shard_t* memm_ptr_set_shard(memm_ptr_set_t* set, void* ptr)
+{
+    return &set->shards[(memm_ptr_set_hash(ptr) >> 32) & (MEMM_SHARD_COUNT - 1)];
+}
+
+/// @brief returns the first slot a pointer may sit at in a shard
+static size_t memm_ptr_shard_home(const memm_ptr_shard_t* shard, void* ptr)
+{
+    return (size_t)(memm_ptr_set_hash(ptr) >> (64 - shard->bits));
+}
+
+/// @brief returns the slot of a pointer in a shard whose lock is held, or its capacity if it isn't there
+static size_t memm_ptr_shard_find(const memm_ptr_shard_t* shard, void* ptr)
+{
+    if (shard->count == 0) return shard->capacity;
+
+    for (size_t slot = memm_ptr_shard_home(shard, ptr); shard->slots[slot]; slot = (slot + 1) & (shard->capacity - 1)) {
+        if (shard->slots[slot] == ptr) return slot;
+    }
+    return shard->capacity;
+}
+
+/// @brief doubles the slots of a shard whose lock is held, returns false when they can't be allocated
+static bool memm_ptr_shard_grow(memm_ptr_shard_t* shard)
+{
+    unsigned bits = shard->capacity ? shard->bits + 1 : 0;
+    if (!shard->capacity) {
+        for (; ((size_t)1 << bits) < MEMM_PTR_SET_SIZE; bits++);
+    }
+
+    size_t capacity = (size_t)1 << bits;
+    void** slots = (void**)memm_libc_calloc(capacity, sizeof(void*));
+    if (!slots) return false;
+
+    void** old_slots = shard->slots;
+    size_t old_capacity = shard->capacity;
+    shard->slots = slots;
+    shard->capacity = capacity;
+    shard->bits = bits;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (!old_slots[i]) continue;
+
+        size_t slot = memm_ptr_shard_home(shard, old_slots[i]);
+        while (slots[slot]) slot = (slot + 1) & (capacity - 1);
+        slots[slot] = old_slots[i];
+    }
+    memm_libc_free(old_slots);
+    return true;
+}
+
+/// @brief adds a pointer to a shard whose lock is held, growing it at half load, returns false when it can't grow
+static bool memm_ptr_shard_insert(memm_ptr_set_t* set, memm_ptr_shard_t* shard, void* ptr, bool moved)
+{
+    if ((shard->count + 1) * 2 > shard->capacity && !memm_ptr_shard_grow(shard)) {
+        // a block that was just moved can't be given back, so it takes one of the slots left past half load
+        if (!moved || shard->count + 1 >= shard->capacity) return false;
+    }
+
+    size_t slot = memm_ptr_shard_home(shard, ptr);
+    while (shard->slots[slot]) slot = (slot + 1) & (shard->capacity - 1);
+    shard->slots[slot] = ptr;
+    shard->count++;
+    memm_atomic_add(&set->count, 1);
+    return true;
+}
+
+/// @brief removes the pointer at a slot of a shard whose lock is held, moving back the rest of its probe run so no tombstone is left
+static void memm_ptr_shard_remove(memm_ptr_set_t* set, memm_ptr_shard_t* shard, size_t slot)
+{
+    size_t mask = shard->capacity - 1;
+    for (size_t next = (slot + 1) & mask; shard->slots[next]; next = (next + 1) & mask) {
+        // an entry can fill the hole only if its home slot isn't cyclically between the hole and it
+        size_t home = memm_ptr_shard_home(shard, shard->slots[next]);
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            shard->slots[slot] = shard->slots[next];
+            slot = next;
+        }
+    }
+    shard->slots[slot] = NULL;
+    shard->count--;
+    memm_atomic_add(&set->count, (size_t)-1);
+}
+
+/// @brief adds a pointer to a set, returns false when the set can't grow
+static bool memm_ptr_set_insert(memm_ptr_set_t* set, void* ptr)
+{
+    memm_ptr_shard_t* shard = memm_ptr_set_shard(set, ptr);
+    memm_lock_acquire(&shard->lock);
+    bool inserted = memm_ptr_shard_insert(set, shard, ptr, false);
+    memm_lock_release(&shard->lock);
+    return inserted;
+}
+
+/// @brief removes a pointer from a set, before its block is released so the allocator can't hand the address out again while it is listed
+static void memm_ptr_set_remove(memm_ptr_set_t* set, void* ptr)
+{
+    memm_ptr_shard_t* shard = memm_ptr_set_shard(set, ptr);
+    memm_lock_acquire(&shard->lock);
+    size_t slot = memm_ptr_shard_find(shard, ptr);
+    if (slot < shard->capacity) {
+        memm_ptr_shard_remove(set, shard, slot);
+    }
+    memm_lock_release(&shard->lock);
+}
+
+/// @brief tells whether a pointer is in a set, only its shard is locked and an empty set isn't locked at all
+static bool memm_ptr_set_contains(memm_ptr_set_t* set, void* ptr)
+{
+    if (memm_atomic_load(&set->count) == 0) return false;
+
+    memm_ptr_shard_t* shard = memm_ptr_set_shard(set, ptr);
+    memm_lock_acquire(&shard->lock);
+    bool found = memm_ptr_shard_find(shard, ptr) < shard->capacity;
+    memm_lock_release(&shard->lock);
+    return found;
+}
+
+/// @brief locks the shard of a block about to be resized, the allocator can't reuse its address for another listed block until memm_ptr_set_move
+static memm_ptr_shard_t* memm_ptr_set_lock(memm_ptr_set_t* set, void* ptr)
+{
+    memm_ptr_shard_t* shard = memm_ptr_set_shard(set, ptr);
+    memm_lock_acquire(&shard->lock);
+    return shard;
+}
+
+/// @brief moves a pointer after its block was resized, new_ptr is NULL when the resize failed, unlocks the shard memm_ptr_set_lock returned
+static bool memm_ptr_set_move(memm_ptr_set_t* set, memm_ptr_shard_t* locked, void* old_ptr, void* new_ptr)
+{
+    if (!new_ptr || new_ptr == old_ptr) {
+        memm_lock_release(&locked->lock);
+        return true;
+    }
+
+    size_t slot = memm_ptr_shard_find(locked, old_ptr);
+    if (slot < locked->capacity) {
+        memm_ptr_shard_remove(set, locked, slot);
+    }
+
+    memm_ptr_shard_t* shard = memm_ptr_set_shard(set, new_ptr);
+    if (shard != locked) {
+        memm_lock_release(&locked->lock);
+        memm_lock_acquire(&shard->lock);
+    }
+    bool inserted = memm_ptr_shard_insert(set, shard, new_ptr, true);
+    memm_lock_release(&shard->lock);
+    return inserted;
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// Mapped Blocks
+
+#ifdef MEMM_MMAP_THRESHOLD
+
+/// @brief bytes reserved at the start of a mapping, keeps user pointers 64-byte aligned
+#define MEMM_MAPPING_HEADER_SIZE 64
+
+/// @brief mappings start at least this aligned, so only pointers at MEMM_MAPPING_HEADER_SIZE past such a boundary can be mapped blocks
+#define MEMM_MAPPING_ALIGNMENT 4096
+
+/// @brief granularity mapping lengths are rounded to
+#ifdef MEMM_MMAP_HUGEPAGES
+    #define MEMM_MAPPING_GRANULARITY ((size_t)2 << 20)
+#else
+    #define MEMM_MAPPING_GRANULARITY ((size_t)MEMM_MAPPING_ALIGNMENT)
+#endif
+
+/// @brief header at the start of every mapping, the user block follows it
+typedef struct memm_mapping
+{
+    size_t length;              // bytes mapped, header included
+} memm_mapping_t;
+
+/// @brief statistics of the mapped blocks, they outlive memm_init/memm_shutdown since mappings may still be alive
+typedef struct memm_mappings
+{
+    size_t count;               // blocks currently mapped
+    size_t mapped_bytes;        // bytes currently mapped, headers and rounding included
+    size_t peak_bytes;          // most bytes simultaneously mapped
+    size_t remaps;              // resizes done by remapping instead of copying
+} memm_mappings_t;
+
+/// @brief mapped blocks statistics
+static memm_mappings_t g_memm_mappings;
+
+/// @brief headers of the live mappings, a pointer is only a mapped block if its header is in it
+static memm_ptr_set_t g_memm_mapping_set;
+
+/// @brief returns the mapping length holding a block of size bytes, or 0 if it would overflow
+static size_t memm_mapping_length(size_t size)
+{
+    if (size > (size_t)-1 - MEMM_MAPPING_HEADER_SIZE - MEMM_MAPPING_GRANULARITY) return 0;
+    return (MEMM_MAPPING_HEADER_SIZE + size + MEMM_MAPPING_GRANULARITY - 1) & ~(MEMM_MAPPING_GRANULARITY - 1);
+}
+
+/// @brief stamps the header of a mapping and returns its user block
+static void* memm_mapping_init(void* base, size_t length)
+{
+    memm_mapping_t* mapping = (memm_mapping_t*)base;
+    mapping->length = length;
+    return (char*)base + MEMM_MAPPING_HEADER_SIZE;
+}
+
+/// @brief accounts a mapping growing by delta bytes, shrinking when delta wrapped around
+static void memm_mapping_count(size_t count, size_t delta)
+{
+    memm_atomic_add(&g_memm_mappings.count, count);
+    memm_atomic_max(&g_memm_mappings.peak_bytes, memm_atomic_add(&g_memm_mappings.mapped_bytes, delta) + delta);
+}
+
+/// @brief maps a zeroed block of at least size bytes straight from the os, returns NULL when it can't
+static void* memm_mapping_alloc(size_t size)
+{
+    size_t length = memm_mapping_length(size);
+    if (!length) return NULL;
+
+    #if defined(_WIN32) || defined(_WIN64)
+    void* base = VirtualAlloc(NULL, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    #else
+    void* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    #if defined(MEMM_MMAP_HUGEPAGES) && defined(MADV_HUGEPAGE)
+    // a hint, the block still works with regular pages when transparent huge pages are disabled
+    madvise(base, length, MADV_HUGEPAGE);
+    #endif
+    #endif
+    if (!base) return NULL;
+
+    #if defined(__linux__) && defined(MREMAP_MAYMOVE)
+    // pairs with the release in memm_mapping_resize, so accesses to pages a remap gave back are ordered before those to this mapping
+    (void)memm_atomic_load_acquire(&g_memm_mappings.remaps);
+    #endif
+
+    if (!memm_ptr_set_insert(&g_memm_mapping_set, base)) {
+        #if defined(_WIN32) || defined(_WIN64)
+        VirtualFree(base, 0, MEM_RELEASE);
+        #else
+        munmap(base, length);
+        #endif
+        return NULL;
+    }
+
+    memm_mapping_count(1, length);
+    return memm_mapping_init(base, length);
+}
+
+/// @brief returns the header of a mapped block, or NULL for any other pointer, only pointers at the right page offset look the set up
+static memm_mapping_t* memm_mapping_of(void* ptr)
+{
+    if (((uintptr_t)ptr & (MEMM_MAPPING_ALIGNMENT - 1)) != MEMM_MAPPING_HEADER_SIZE) return NULL;
+
+    memm_mapping_t* mapping = (memm_mapping_t*)((char*)ptr - MEMM_MAPPING_HEADER_SIZE);
+    return memm_ptr_set_contains(&g_memm_mapping_set, mapping) ? mapping : NULL;
+}
+
+/// @brief unmaps a mapped block
+static void memm_mapping_free(memm_mapping_t* mapping)
+{
+    size_t length = mapping->length;
+    // unlisted first, so the os can't hand the address to another mapping while it is still in the set
+    memm_ptr_set_remove(&g_memm_mapping_set, mapping);
+    #if defined(_WIN32) || defined(_WIN64)
+    VirtualFree(mapping, 0, MEM_RELEASE);
+    #else
+    munmap(mapping, length);
+    #endif
+    memm_mapping_count((size_t)-1, (size_t)0 - length);
+}
+
+/// @brief resizes a mapped block to another mapped size, remapping the pages on linux instead of copying them
+static void* memm_mapping_resize(memm_mapping_t* mapping, size_t size)
+{
+    size_t length = memm_mapping_length(size);
+    if (!length) return NULL;
+    if (length == mapping->length) return (char*)mapping + MEMM_MAPPING_HEADER_SIZE;
+
+    #if defined(__linux__) && defined(MREMAP_MAYMOVE)
+    // the shard stays locked across the move, so the released address can't be mapped and listed by another thread meanwhile
+    size_t old_length = mapping->length;
+    memm_ptr_shard_t* shard = memm_ptr_set_lock(&g_memm_mapping_set, mapping);
+    // counted beforehand with release ordering, the pages mremap gives back may be mapped by another thread under any shard
+    memm_atomic_add_release(&g_memm_mappings.remaps, 1);
+    void* base = mremap(mapping, old_length, length, MREMAP_MAYMOVE);
+    if (!memm_ptr_set_move(&g_memm_mapping_set, shard, mapping, base == MAP_FAILED ? NULL : base)) {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: Failed to list the remapped block %p\n", base);
+        #endif
+    }
+    if (base == MAP_FAILED) {
+        memm_atomic_add(&g_memm_mappings.remaps, (size_t)-1);
+        return NULL;
+    }
+
+    // the block may have grown into pages another remap just gave back
+    (void)memm_atomic_load_acquire(&g_memm_mappings.remaps);
+
+    memm_mapping_count(0, length - old_length);
+    return memm_mapping_init(base, length);
+    #else
+    void* ptr = memm_mapping_alloc(size);
+    if (!ptr) return NULL;
+
+    size_t usable = mapping->length - MEMM_MAPPING_HEADER_SIZE;
+    memcpy(ptr, (char*)mapping + MEMM_MAPPING_HEADER_SIZE, size < usable ? size : usable);
+    memm_mapping_free(mapping);
+    return ptr;
+    #endif
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// System Allocator
+
+/// @brief alignment every malloc block already has, larger ones need an aligned allocation
+#define MEMM_MALLOC_ALIGNMENT (2 * sizeof(void*))
+
+/// @brief allocates a block aligned to a power of 2 larger than MEMM_MALLOC_ALIGNMENT from the system allocator, releasable with free
+static void* memm_libc_aligned_alloc(size_t alignment, size_t size)
+{
+    #if defined(_WIN32) || defined(_WIN64)
+    // the crt only releases _aligned_malloc blocks with _aligned_free, which free can't tell apart
+    (void)alignment;
+    (void)size;
+    return NULL;
+    #else
+    void* ptr = NULL;
+    return memm_libc_posix_memalign(&ptr, alignment, size) == 0 ? ptr : NULL;
+    #endif
+}
+
+#if defined(MEMM_SMALL_ALLOCATOR) || defined(MEMM_MMAP_THRESHOLD)
+
+/// @brief allocates a user block, small ones from the size classes, large ones mapped and the rest from the system
+static void* memm_system_malloc(size_t size)
+{
+    #ifdef MEMM_SMALL_ALLOCATOR
+    if (size <= MEMM_SMALL_MAX_SIZE) {
+        void* block = memm_small_malloc(memm_small_class(size));
+        if (block) return block;
+    }
+    #endif
+
+    #ifdef MEMM_MMAP_THRESHOLD
+    if (size >= MEMM_MMAP_THRESHOLD) {
+        void* block = memm_mapping_alloc(size);
+        if (block) return block;
+    }
+    #endif
+    return memm_libc_malloc(size);
+}
+
+/// @brief zeroed-allocates a user block
+static void* memm_system_calloc(size_t num, size_t size)
+{
+    if (size != 0 && num > (size_t)-1 / size) return NULL;
+
+    #ifdef MEMM_SMALL_ALLOCATOR
+    // recycled blocks are dirty, so they are cleared like the system calloc would
+    if (num * size <= MEMM_SMALL_MAX_SIZE) {
+        void* block = memm_small_malloc(memm_small_class(num * size));
+        if (block) return memset(block, 0, num * size);
+    }
+    #endif
+
+    #ifdef MEMM_MMAP_THRESHOLD
+    // fresh mappings are already zeroed
+    if (num * size >= MEMM_MMAP_THRESHOLD) {
+        void* block = memm_mapping_alloc(num * size);
+        if (block) return block;
+    }
+    #endif
+    return memm_libc_calloc(num, size);
+}
+
+/// @brief allocates a user block aligned to a power of 2 larger than MEMM_MALLOC_ALIGNMENT
+static void* memm_system_aligned_alloc(size_t alignment, size_t size)
+{
+    #ifdef MEMM_SMALL_ALLOCATOR
+    // pages start on os page boundaries and are carved from their start, so a class whose size is a multiple of the alignment only has aligned blocks
+    if (alignment <= MEMM_SMALL_MAX_ALIGNMENT && size <= MEMM_SMALL_MAX_SIZE) {
+        size_t rounded = ((size ? size : 1) + alignment - 1) & ~(alignment - 1);
+        if (rounded <= MEMM_SMALL_MAX_SIZE) {
+            void* block = memm_small_malloc(memm_small_class(rounded));
+            if (block) return block;
+        }
+    }
+    #endif
+
+    #ifdef MEMM_MMAP_THRESHOLD
+    if (alignment <= MEMM_MAPPING_HEADER_SIZE && size >= MEMM_MMAP_THRESHOLD) {
+        void* block = memm_mapping_alloc(size);
+        if (block) return block;
+    }
+    #endif
+    return memm_libc_aligned_alloc(alignment, size);
+}
+
+/// @brief deallocates a user block from wherever it was allocated
+static void memm_system_free(void* ptr)
+{
+    #ifdef MEMM_SMALL_ALLOCATOR
+    size_t offset = memm_small_offset(ptr);
+    if (offset < MEMM_SMALL_HEAP_SIZE) {
+        memm_small_free(ptr, offset);
+        return;
+    }
+    #endif
+
+    #ifdef MEMM_MMAP_THRESHOLD
+    memm_mapping_t* mapping = memm_mapping_of(ptr);
+    if (mapping) {
+        memm_mapping_free(mapping);
+        return;
+    }
+    #endif
+    memm_libc_free(ptr);
+}
+
+/// @brief resizes a user block, small blocks stay in place while the new size fits their size class and mapped blocks are remapped
+static void* memm_system_realloc(void* ptr, size_t size)
+{
+    if (!ptr) return memm_system_malloc(size);
+
+    #ifdef MEMM_SMALL_ALLOCATOR
+    size_t offset = memm_small_offset(ptr);
+    if (offset < MEMM_SMALL_HEAP_SIZE) {
+        size_t block_size = memm_small_class_size(g_memm_small.page_classes[offset / MEMM_SMALL_PAGE_SIZE]);
+        if (size <= block_size && (size > block_size / 2 || block_size == 16)) return ptr;
+
+        void* new_ptr = memm_system_malloc(size);
+        if (!new_ptr) return NULL;
+
+        memcpy(new_ptr, ptr, size < block_size ? size : block_size);
+        memm_small_free(ptr, offset);
+        return new_ptr;
+    }
+    #endif
+
+    #ifdef MEMM_MMAP_THRESHOLD
+    memm_mapping_t* mapping = memm_mapping_of(ptr);
+    if (mapping) {
+        if (size >= MEMM_MMAP_THRESHOLD) return memm_mapping_resize(mapping, size);
+
+        // shrunk below the threshold, the block goes back to the regular allocators
+        size_t usable = mapping->length - MEMM_MAPPING_HEADER_SIZE;
+        void* new_ptr = memm_system_malloc(size);
+        if (!new_ptr) return NULL;
+
+        memcpy(new_ptr, ptr, size < usable ? size : usable);
+        memm_mapping_free(mapping);
+        return new_ptr;
+    }
+    #endif
+
+    // blocks of the system allocator stay there, it knows their size and may grow them in place
+    return memm_libc_realloc(ptr, size);
+}
+
+#ifdef MEMM_SAMPLING
+/// @brief returns how many bytes a user block can actually hold
+static size_t memm_system_usable_size(void* ptr)
+{
+    #ifdef MEMM_SMALL_ALLOCATOR
+    size_t offset = memm_small_offset(ptr);
+    if (offset < MEMM_SMALL_HEAP_SIZE) {
+        return memm_small_class_size(g_memm_small.page_classes[offset / MEMM_SMALL_PAGE_SIZE]);
+    }
+    #endif
+
+    #ifdef MEMM_MMAP_THRESHOLD
+    memm_mapping_t* mapping = memm_mapping_of(ptr);
+    if (mapping) {
+        return mapping->length - MEMM_MAPPING_HEADER_SIZE;
+    }
+    #endif
+    return memm_usable_size(ptr);
+}
+#endif
+
+#else
+
+/// @brief without MEMM_SMALL_ALLOCATOR nor MEMM_MMAP_THRESHOLD every user block comes from the system allocator
+#define memm_system_malloc(size) memm_libc_malloc(size)
+#define memm_system_calloc(num, size) memm_libc_calloc(num, size)
+#define memm_system_aligned_alloc(alignment, size) memm_libc_aligned_alloc(alignment, size)
+#define memm_system_realloc(ptr, size) memm_libc_realloc(ptr, size)
+#define memm_system_free(ptr) memm_libc_free(ptr)
+#ifdef MEMM_SAMPLING
+    #define memm_system_usable_size(ptr) memm_usable_size(ptr)
+#endif
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// Internal Implementation
+
+/// @brief holds an alocation information, with MEMM_INLINE_HEADERS it is the header placed right before the user block
+typedef struct memm_allocation
+{
+    #ifndef MEMM_INLINE_HEADERS
+    void* ptr;
+    #endif
+    size_t size;
+    uint32_t callsite;                  // interned (file, line) the block was allocated from
+    #ifdef MEMM_INLINE_HEADERS
+    uint32_t magic;                     // MEMM_HEADER_MAGIC with the tracking level in the low bits while the block is tracked
+    uint32_t session;                   // g_memm_session the block was tracked in
+    #else
+    uint32_t level;                     // tracking level the block was allocated with
+    #endif
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    uint64_t timestamp;                 // memm_clock_ticks() when the block was allocated
+    #endif
+    #ifdef MEMM_INLINE_HEADERS
+    struct memm_allocation* prev;       // intrusive list of live blocks
+    struct memm_allocation* next;
+    #endif
+} memm_allocation_t;
+
+/// @brief returns when a block was allocated, in clock ticks
+#if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    #define memm_allocation_timestamp(alloc) ((alloc)->timestamp)
+#else
+    #define memm_allocation_timestamp(alloc) ((uint64_t)0)
+#endif
+
+#ifndef MEMM_INLINE_HEADERS
+
+/// @brief a slot of the pointer index, empty slots have a null key
+typedef struct memm_slot
+{
+    const void* ptr;
+    memm_allocation_t* alloc;
+} memm_slot_t;
+
+/// @brief open-addressing pointer index (robin hood probing), grows by draining the previous table a few slots at a time
+typedef struct memm_index
+{
+    memm_slot_t* slots;         // current table
+    size_t capacity;            // slots in the current table, power of 2
+    unsigned bits;              // log2 of capacity
+    size_t count;               // live entries in the current table
+    memm_slot_t* old_slots;     // previous table, still being drained after a grow
+    size_t old_capacity;        // slots in the previous table
+    unsigned old_bits;          // log2 of old_capacity
+    size_t old_count;           // live entries left in the previous table
+    size_t migrate_cursor;      // next slot of the previous table to be migrated
+} memm_index_t;
+
+#endif
+
+/// @brief header of a chunk of fixed-size objects, the objects follow it
+typedef struct memm_slab
+{
+    struct memm_slab* next;
+} memm_slab_t;
+
+/// @brief fixed-size object pool, objects are bump-allocated from slabs and recycled through an embedded free list
+typedef struct memm_slab_pool
+{
+    size_t object_size;         // bytes per object, at least a pointer so released objects can hold the free list link
+    size_t objects_per_slab;    // objects carved from each slab
+    memm_slab_t* slabs;         // every slab owned by the pool
+    size_t slab_count;          // how many slabs were allocated
+    void* free_list;            // released objects, linked through their first bytes
+    char* bump;                 // next never-used object of the newest slab
+    char* bump_end;             // end of the newest slab
+} memm_slab_pool_t;
+
+/// @brief independently locked part of the tracking structures, pointers are spread across shards by hash
+typedef struct memm_shard
+{
+    memm_lock_t lock;
+    #ifdef MEMM_INLINE_HEADERS
+    memm_allocation_t* live;    // head of the intrusive list of live blocks
+    #else
+    memm_index_t index;
+    memm_slab_pool_t records;   // pool the tracking records come from
+    size_t tracked;             // entries in the index, read without the lock to skip lookups of untracked blocks
+    #endif
+    char padding[64];           // keeps neighbour shard locks off the same cache line
+} memm_shard_t;
+
+/// @brief statistics counters, with MEMM_THREAD_SAFE every thread owns a block and only the owner writes to it
+typedef struct memm_counters
+{
+    size_t total_allocated;     // bytes allocated
+    size_t total_freed;         // bytes freed
+    size_t allocation_count;    // allocations calls count
+    size_t free_count;          // free calls count
+    size_t unpublished;         // live bytes delta not yet added to the shared usage estimate, wraps around when negative
+    size_t size_classes[MEMM_SIZE_BUCKETS]; // allocations by memm_size_class
+    struct memm_counters* next; // next block in the registry
+} memm_counters_t;
+
+/// @brief every per-thread counters block ever created, blocks outlive memm_init/memm_shutdown since threads keep pointing at them
+typedef struct memm_registry
+{
+    memm_lock_t lock;
+    memm_counters_t* head;
+} memm_registry_t;
+
+/// @brief an interned allocation site and its aggregate statistics, maintained incrementally as blocks come and go
+typedef struct memm_callsite
+{
+    const char* file;
+    int line;
+    size_t live_count;          // blocks currently alive
+    size_t live_bytes;          // bytes currently alive
+    size_t total_bytes;         // bytes ever allocated
+    size_t call_count;          // allocations ever made
+    size_t peak_bytes;          // most bytes simultaneously alive
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    size_t lifetimes[MEMM_LIFETIME_BUCKETS]; // freed blocks by bit length of their lifetime in clock ticks
+    #endif
+} memm_callsite_t;
+
+/// @brief how many callsites are stored per page, pages never move so ids resolve without locking
+#define MEMM_CALLSITE_PAGE_SIZE 1024
+
+/// @brief how many pages are needed to hold MEMM_MAX_CALLSITES
+#define MEMM_CALLSITE_PAGES ((MEMM_MAX_CALLSITES + MEMM_CALLSITE_PAGE_SIZE - 1) / MEMM_CALLSITE_PAGE_SIZE)
+
+/// @brief every callsite ever interned, ids outlive memm_init/memm_shutdown since callers cache them
+typedef struct memm_callsites
+{
+    memm_lock_t lock;
+    memm_callsite_t* pages[MEMM_CALLSITE_PAGES];
+    uint32_t count;             // ids handed out, including the unknown callsite 0
+    uint32_t* table;            // open-addressing (file, line) -> id, 0 marks an empty slot
+    size_t capacity;            // slots in table, power of 2
+} memm_callsites_t;
+
+#ifdef MEMM_SAMPLING
+/// @brief slots of the sampled pointer filter, a counting bloom filter with a single hash
+#define MEMM_SAMPLE_FILTER_BITS 14
+#define MEMM_SAMPLE_FILTER_SIZE ((size_t)1 << MEMM_SAMPLE_FILTER_BITS)
+#endif
+
+/// @brief holds the memm state, wich keeps tracks of all memory allocated stuff
+typedef struct memm
+{
+    memm_shard_t shards[MEMM_SHARD_COUNT];
+    #ifndef MEMM_THREAD_SAFE
+    memm_counters_t counters;   // the only counters block
+    #endif
+    size_t published_usage;     // sum of the published deltas, the shared usage estimate the peak is tracked against
+    size_t peak_memory;         // max memory simultaneosly allocated, used 
+    size_t untracked_blocks;    // set once a block was handed out untracked, after that unknown frees are expected
+    size_t size_mismatches;     // sized frees whose size didn't match the block
+    size_t untracked_frees;     // frees of blocks memm didn't know, released straight to the allocator
+    #ifdef MEMM_CLOCK_CALIBRATED
+    uint64_t clock_anchor_ticks; // cycle counter at memm_init
+    uint64_t clock_anchor_ns;    // monotonic clock at memm_init
+    #endif
+    #ifdef MEMM_SAMPLING
+    size_t sample_filter[MEMM_SAMPLE_FILTER_SIZE]; // live sampled blocks by filter slot, 0 proves a pointer has no record
+    #endif
+} memm_t;
+
+/// @brief global state
+static memm_t g_memm = { 0 };
+
+/// @brief set by the first memm_init, blocks allocated before it are kept instead of being reset
+static bool g_memm_initialized = false;
+
+#ifdef MEMM_INLINE_HEADERS
+/// @brief bumped by every memm_init that resets the state, headers of blocks tracked before it no longer count
+static uint32_t g_memm_session = 0;
+#endif
+
+/// @brief tracking level of new allocations, outlives memm_init so it can be set before it
+static size_t g_memm_level = MEMM_DEFAULT_LEVEL;
+
+/// @brief per-thread counters registry
+static memm_registry_t g_memm_registry = { MEMM_LOCK_INITIALIZER, NULL };
+
+/// @brief callsite registry
+static memm_callsites_t g_memm_callsites = { MEMM_LOCK_INITIALIZER, { NULL }, 0, NULL, 0 };
+
+/// @brief direct-mapped cache of recently interned callsites, keyed by the file pointer and line
+typedef struct memm_callsite_cache
+{
+    const char* file;
+    int line;
+    uint32_t id;
+} memm_callsite_cache_t;
+
+/// @brief entries of the per-thread callsite cache, power of 2
+#define MEMM_CALLSITE_CACHE_SIZE 64
+
+/// @brief per-thread callsite cache, spares the registry lock for callers that can't cache ids themselves
+static MEMM_THREAD_LOCAL memm_callsite_cache_t t_memm_callsite_cache[MEMM_CALLSITE_CACHE_SIZE];
+
+/// @brief size of a counters block, rounded to a cache line so threads never write to a shared one
+#define MEMM_COUNTERS_SIZE ((sizeof(memm_counters_t) + 63) & ~(size_t)63)
+
+#ifdef MEMM_THREAD_SAFE
+/// @brief counters block of the calling thread, created on its first allocation or free
+static MEMM_THREAD_LOCAL memm_counters_t* t_memm_counters = NULL;
+#endif
+
+/// @brief returns the counters block the calling thread updates
+static memm_counters_t* memm_local_counters()
+{
+    #ifdef MEMM_THREAD_SAFE
+    if (!t_memm_counters) {
+        // blocks are never released, threads may keep their pointer past memm_shutdown
+        char* raw = (char*)memm_libc_calloc(1, MEMM_COUNTERS_SIZE + 63);
+        if (!raw) {
+            return NULL;
+        }
+
+        memm_counters_t* counters = (memm_counters_t*)(((size_t)raw + 63) & ~(size_t)63);
+        memm_lock_acquire(&g_memm_registry.lock);
+        counters->next = g_memm_registry.head;
+        g_memm_registry.head = counters;
+        memm_lock_release(&g_memm_registry.lock);
+        t_memm_counters = counters;
+    }
+    return t_memm_counters;
+    #else
+    return &g_memm.counters;
+    #endif
+}
+
+/// @brief adds every counters block together, each field is exact on its own but they are not a consistent snapshot
+static void memm_counters_sum(memm_counters_t* sum)
+{
+    memset(sum, 0, sizeof(*sum));
+    #ifdef MEMM_THREAD_SAFE
+    memm_lock_acquire(&g_memm_registry.lock);
+    for (memm_counters_t* counters = g_memm_registry.head; counters; counters = counters->next) {
+        sum->total_allocated += memm_atomic_load(&counters->total_allocated);
+        sum->total_freed += memm_atomic_load(&counters->total_freed);
+        sum->allocation_count += memm_atomic_load(&counters->allocation_count);
+        sum->free_count += memm_atomic_load(&counters->free_count);
+    }
+    memm_lock_release(&g_memm_registry.lock);
+    #else
+    sum->total_allocated = g_memm.counters.total_allocated;
+    sum->total_freed = g_memm.counters.total_freed;
+    sum->allocation_count = g_memm.counters.allocation_count;
+    sum->free_count = g_memm.counters.free_count;
+    #endif
+}
+
+/// @brief adds the size histograms of every counters block together, kept apart from memm_counters_sum so usage getters stay cheap
+static void memm_size_classes_sum(size_t* sum)
+{
+    memset(sum, 0, sizeof(size_t) * MEMM_SIZE_BUCKETS);
+    #ifdef MEMM_THREAD_SAFE
+    memm_lock_acquire(&g_memm_registry.lock);
+    for (memm_counters_t* counters = g_memm_registry.head; counters; counters = counters->next) {
+        for (size_t i = 0; i < MEMM_SIZE_BUCKETS; i++) {
+            sum[i] += memm_atomic_load(&counters->size_classes[i]);
+        }
+    }
+    memm_lock_release(&g_memm_registry.lock);
+    #else
+    memcpy(sum, g_memm.counters.size_classes, sizeof(size_t) * MEMM_SIZE_BUCKETS);
+    #endif
+}
+
+/// @brief clears every counters block, only meaningful while no other thread is allocating
+static void memm_counters_reset()
+{
+    memm_lock_acquire(&g_memm_registry.lock);
+    for (memm_counters_t* counters = g_memm_registry.head; counters; counters = counters->next) {
+        memm_counters_t* next = counters->next;
+        memset(counters, 0, sizeof(*counters));
+        counters->next = next;
+    }
+    memm_lock_release(&g_memm_registry.lock);
+}
+
+/// @brief adds a thread's pending delta to the shared usage estimate, raising the peak when it grew
+static void memm_publish_usage(memm_counters_t* counters)
+{
+    size_t delta = counters->unpublished;
+    counters->unpublished = 0;
+    size_t usage = memm_atomic_add(&g_memm.published_usage, delta) + delta;
+
+    // a wrapped-around estimate means frees were published before the matching allocations
+    if ((ptrdiff_t)usage > 0) {
+        memm_atomic_max(&g_memm.peak_memory, usage);
+    }
+}
+
+/// @brief what id 0 and ids never handed out resolve to, accumulates the statistics of allocations without a callsite
+#if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+static memm_callsite_t g_memm_unknown_callsite = { "unknown", 0, 0, 0, 0, 0, 0, { 0 } };
+#else
+static memm_callsite_t g_memm_unknown_callsite = { "unknown", 0, 0, 0, 0, 0, 0 };
+#endif
+
+/// @brief resolves a callsite id, unknown ids resolve to the unknown callsite
+static memm_callsite_t* memm_callsite_get(uint32_t id)
+{
+    if (id == 0 || id >= MEMM_CALLSITE_PAGES * MEMM_CALLSITE_PAGE_SIZE) {
+        return &g_memm_unknown_callsite;
+    }
+
+    memm_callsite_t* page = g_memm_callsites.pages[id / MEMM_CALLSITE_PAGE_SIZE];
+    return page && page[id % MEMM_CALLSITE_PAGE_SIZE].file ? &page[id % MEMM_CALLSITE_PAGE_SIZE] : &g_memm_unknown_callsite;
+}
+
+/// @brief hashes a (file, line) pair by file contents, since each translation unit may have its own copy of __FILE__
+static size_t memm_callsite_hash(const char* file, int line)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* c = file; *c; c++) {
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ull;
+    }
+    hash = (hash ^ (uint64_t)(unsigned int)line) * 11400714819323198485ull;
+    return (size_t)(hash >> 32);
+}
+
+/// @brief places an id on the callsite table, which must have a free slot
+static void memm_callsite_place(uint32_t* table, size_t capacity, uint32_t id)
+{
+    const memm_callsite_t* callsite = memm_callsite_get(id);
+    size_t slot = memm_callsite_hash(callsite->file, callsite->line) & (capacity - 1);
+    while (table[slot]) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    table[slot] = id;
+}
+
+/// @brief doubles the callsite table, keeping it at most half full
+static bool memm_callsite_grow()
+{
+    size_t capacity = g_memm_callsites.capacity ? g_memm_callsites.capacity * 2 : 1024;
+    uint32_t* table = (uint32_t*)memm_libc_calloc(capacity, sizeof(uint32_t));
+    if (!table) {
+        return false;
+    }
+
+    for (size_t i = 0; i < g_memm_callsites.capacity; i++) {
+        if (g_memm_callsites.table[i]) {
+            memm_callsite_place(table, capacity, g_memm_callsites.table[i]);
+        }
+    }
+    memm_libc_free(g_memm_callsites.table);
+    g_memm_callsites.table = table;
+    g_memm_callsites.capacity = capacity;
+    return true;
+}
+
+/// @brief finds or creates the id of a (file, line) pair under the registry lock, 0 when the registry is full
+static uint32_t memm_callsite_intern_locked(const char* file, int line)
+{
+    size_t hash = memm_callsite_hash(file, line);
+    if (g_memm_callsites.capacity) {
+        for (size_t slot = hash & (g_memm_callsites.capacity - 1); g_memm_callsites.table[slot]; slot = (slot + 1) & (g_memm_callsites.capacity - 1)) {
+            const memm_callsite_t* callsite = memm_callsite_get(g_memm_callsites.table[slot]);
+            if (callsite->line == line && (callsite->file == file || strcmp(callsite->file, file) == 0)) {
+                return g_memm_callsites.table[slot];
+            }
+        }
+    }
+
+    // id 0 is reserved for the unknown callsite
+    uint32_t id = g_memm_callsites.count ? g_memm_callsites.count : 1;
+    if (id >= MEMM_CALLSITE_PAGES * MEMM_CALLSITE_PAGE_SIZE) {
+        return 0;
+    }
+
+    if ((size_t)id * 2 >= g_memm_callsites.capacity && !memm_callsite_grow()) {
+        return 0;
+    }
+
+    memm_callsite_t** page = &g_memm_callsites.pages[id / MEMM_CALLSITE_PAGE_SIZE];
+    if (!*page) {
+        *page = (memm_callsite_t*)memm_libc_calloc(MEMM_CALLSITE_PAGE_SIZE, sizeof(memm_callsite_t));
+        if (!*page) {
+            return 0;
+        }
+    }
+
+    (*page)[id % MEMM_CALLSITE_PAGE_SIZE].file = file;
+    (*page)[id % MEMM_CALLSITE_PAGE_SIZE].line = line;
+    g_memm_callsites.count = id + 1;
+    memm_callsite_place(g_memm_callsites.table, g_memm_callsites.capacity, id);
+    return id;
+}
+
+/// @brief returns how many callsite ids were handed out, including the unknown callsite 0
+static uint32_t memm_callsite_count()
+{
+    memm_lock_acquire(&g_memm_callsites.lock);
+    uint32_t count = g_memm_callsites.count ? g_memm_callsites.count : 1;
+    memm_lock_release(&g_memm_callsites.lock);
+    return count;
+}
+
+/// @brief clears the statistics of every callsite, keeping the ids
+static void memm_callsite_reset()
+{
+    uint32_t count = memm_callsite_count();
+    for (uint32_t id = 0; id < count; id++) {
+        memm_callsite_t* callsite = memm_callsite_get(id);
+        callsite->live_count = 0;
+        callsite->live_bytes = 0;
+        callsite->total_bytes = 0;
+        callsite->call_count = 0;
+        callsite->peak_bytes = 0;
+        #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+        memset(callsite->lifetimes, 0, sizeof(callsite->lifetimes));
+        #endif
+    }
+}
+
+/// @brief returns the statistic of a callsite a top-N report is sorted by
+static size_t memm_callsite_key(const memm_callsite_t* callsite, memm_sort_key_t sort_key)
+{
+    switch (sort_key) {
+        case MEMM_SORT_LIVE_COUNT: return memm_atomic_load(&callsite->live_count);
+        case MEMM_SORT_TOTAL_BYTES: return memm_atomic_load(&callsite->total_bytes);
+        case MEMM_SORT_CALL_COUNT: return memm_atomic_load(&callsite->call_count);
+        case MEMM_SORT_PEAK_BYTES: return memm_atomic_load(&callsite->peak_bytes);
+        case MEMM_SORT_FREED_COUNT: return memm_atomic_load(&callsite->call_count) - memm_atomic_load(&callsite->live_count);
+        default: return memm_atomic_load(&callsite->live_bytes);
+    }
+}
+
+/// @brief a candidate of a top-N callsite report
+typedef struct memm_top_entry
+{
+    size_t key;
+    uint32_t id;
+} memm_top_entry_t;
+
+/// @brief places entry at the root of a min-heap and sifts it down to its place
+static void memm_top_sift_down(memm_top_entry_t* heap, size_t size, memm_top_entry_t entry)
+{
+    size_t i = 0;
+    for (;;) {
+        size_t child = i * 2 + 1;
+        if (child >= size) break;
+        if (child + 1 < size && heap[child + 1].key < heap[child].key) {
+            child++;
+        }
+        if (heap[child].key >= entry.key) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = entry;
+}
+
+/// @brief selects the n callsites with highest sort_key into heap, in descending order, returning how many were selected
+static size_t memm_callsite_select(memm_top_entry_t* heap, size_t n, memm_sort_key_t sort_key)
+{
+    // keeps the best n callsites in a min-heap, so the whole selection is a single pass over the callsites
+    uint32_t count = memm_callsite_count();
+    size_t heap_size = 0;
+    for (uint32_t id = 0; id < count; id++) {
+        memm_callsite_t* site = memm_callsite_get(id);
+        if (memm_atomic_load(&site->call_count) == 0) continue;
+
+        memm_top_entry_t entry = { memm_callsite_key(site, sort_key), id };
+        if (heap_size < n) {
+            // sift the new entry up
+            size_t i = heap_size++;
+            while (i > 0 && heap[(i - 1) / 2].key > entry.key) {
+                heap[i] = heap[(i - 1) / 2];
+                i = (i - 1) / 2;
+            }
+            heap[i] = entry;
+        }
+
+        else if (entry.key > heap[0].key) {
+            memm_top_sift_down(heap, heap_size, entry);
+        }
+    }
+
+    // popping the min-heap yields ascending order, so the output is filled from the back
+    for (size_t end = heap_size; end > 1; end--) {
+        memm_top_entry_t smallest = heap[0];
+        memm_top_sift_down(heap, end - 1, heap[end - 1]);
+        heap[end - 1] = smallest;
+    }
+    return heap_size;
+}
+
+/// @brief accounts allocations on a callsite, count and bytes are scaled estimates with MEMM_SAMPLING
+static void memm_callsite_count_allocation(uint32_t callsite, size_t count, size_t bytes)
+{
+    memm_callsite_t* site = memm_callsite_get(callsite);
+    memm_atomic_add(&site->call_count, count);
+    memm_atomic_add(&site->total_bytes, bytes);
+    memm_atomic_add(&site->live_count, count);
+    memm_atomic_max(&site->peak_bytes, memm_atomic_add(&site->live_bytes, bytes) + bytes);
+}
+
+#if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+/// @brief adds count blocks allocated at timestamp and freed at now to the lifetime histogram of a callsite
+static void memm_callsite_count_lifetime(memm_callsite_t* site, size_t count, uint64_t timestamp, uint64_t now)
+{
+    unsigned bucket = memm_bit_length(now > timestamp ? now - timestamp : 0);
+    memm_atomic_add(&site->lifetimes[bucket < MEMM_LIFETIME_BUCKETS ? bucket : MEMM_LIFETIME_BUCKETS - 1], count);
+}
+#endif
+
+/// @brief accounts frees on a callsite, timestamp is when the blocks were allocated or 0 if unknown
+static void memm_callsite_count_free(uint32_t callsite, size_t count, size_t bytes, uint64_t timestamp)
+{
+    memm_callsite_t* site = memm_callsite_get(callsite);
+    memm_atomic_add(&site->live_count, (size_t)0 - count);
+    memm_atomic_add(&site->live_bytes, (size_t)0 - bytes);
+
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    // a clock read, a bit scan and an increment, so lifetimes can stay on in production
+    if (timestamp) {
+        memm_callsite_count_lifetime(site, count, timestamp, memm_clock_ticks());
+    }
+    #else
+    (void)timestamp;
+    #endif
+}
+
+#ifdef MEMM_REALLOC_KEEPS_ORIGIN
+/// @brief accounts a block of a callsite growing or shrinking from size to new_size bytes
+static void memm_callsite_count_resize(uint32_t callsite, size_t size, size_t new_size)
+{
+    memm_callsite_t* site = memm_callsite_get(callsite);
+    if (new_size >= size) {
+        memm_atomic_add(&site->total_bytes, new_size - size);
+        memm_atomic_max(&site->peak_bytes, memm_atomic_add(&site->live_bytes, new_size - size) + new_size - size);
+    }
+
+    else {
+        memm_atomic_add(&site->live_bytes, (size_t)0 - (size - new_size));
+    }
+}
+#endif
+
+/// @brief accounts count allocations of size bytes on the calling thread's counters, bytes is what the matching frees will subtract
+static void memm_counters_count_allocation(size_t size, size_t count, size_t bytes)
+{
+    memm_counters_t* counters = memm_local_counters();
+    if (!counters) return;
+
+    memm_atomic_store(&counters->total_allocated, counters->total_allocated + bytes);
+    memm_atomic_store(&counters->allocation_count, counters->allocation_count + count);
+    size_t size_class = memm_size_class(size);
+    memm_atomic_store(&counters->size_classes[size_class], counters->size_classes[size_class] + count);
+
+    // the shared estimate is only touched once a thread accumulated MEMM_PEAK_PUBLISH_BYTES of growth
+    counters->unpublished += bytes;
+    if ((ptrdiff_t)counters->unpublished >= (ptrdiff_t)MEMM_PEAK_PUBLISH_BYTES) {
+        memm_publish_usage(counters);
+    }
+}
+
+/// @brief accounts count frees of bytes in total on the calling thread's counters
+static void memm_counters_count_free(size_t count, size_t bytes)
+{
+    memm_counters_t* counters = memm_local_counters();
+    if (!counters) return;
+
+    memm_atomic_store(&counters->total_freed, counters->total_freed + bytes);
+    memm_atomic_store(&counters->free_count, counters->free_count + count);
+
+    counters->unpublished -= bytes;
+    if ((ptrdiff_t)counters->unpublished <= -(ptrdiff_t)MEMM_PEAK_PUBLISH_BYTES) {
+        memm_publish_usage(counters);
+    }
+}
+
+/// @brief accounts an allocation on the calling thread's counters, and on its callsite from the callsites level up
+static void memm_count_allocation(size_t size, uint32_t callsite, size_t level)
+{
+    if (level >= MEMM_LEVEL_CALLSITES) {
+        memm_callsite_count_allocation(callsite, 1, size);
+    }
+    memm_counters_count_allocation(size, 1, size);
+}
+
+/// @brief accounts a free at the level the block was allocated with, timestamp is when it was allocated or 0 if unknown
+static void memm_count_free(size_t size, uint32_t callsite, uint64_t timestamp, size_t level)
+{
+    if (level >= MEMM_LEVEL_CALLSITES) {
+        memm_callsite_count_free(callsite, 1, size, level == MEMM_LEVEL_FULL ? timestamp : 0);
+    }
+    memm_counters_count_free(1, size);
+}
+
+#ifndef MEMM_SAMPLING
+/// @brief accounts a realloc at the level the block was allocated with, on the counters it is a free and an allocation
+static void memm_count_resize(size_t size, uint32_t callsite, uint64_t timestamp, size_t new_size, uint32_t new_callsite, size_t level)
+{
+    if (level >= MEMM_LEVEL_CALLSITES) {
+        #ifdef MEMM_REALLOC_KEEPS_ORIGIN
+        // the block stays with the callsite that allocated it, which only sees its size change
+        (void)timestamp;
+        (void)new_callsite;
+        memm_callsite_count_resize(callsite, size, new_size);
+        #else
+        memm_callsite_count_free(callsite, 1, size, level == MEMM_LEVEL_FULL ? timestamp : 0);
+        memm_callsite_count_allocation(new_callsite, 1, new_size);
+        #endif
+    }
+    memm_counters_count_free(1, size);
+    memm_counters_count_allocation(new_size, 1, new_size);
+}
+#endif
+
+#ifdef MEMM_SAMPLING
+/// @brief xorshift state of the calling thread, 0 until its first allocation
+static MEMM_THREAD_LOCAL uint64_t t_memm_sample_random = 0;
+
+/// @brief bytes the calling thread may still allocate before its next sample
+static MEMM_THREAD_LOCAL size_t t_memm_sample_countdown = 0;
+
+/// @brief returns the filter slot of a pointer, from the top bits of a fibonacci product
+static size_t* memm_sample_filter_of(const void* ptr)
+{
+    return &g_memm.sample_filter[((uint64_t)(size_t)ptr * 0x9E3779B97F4A7C15ull) >> (64 - MEMM_SAMPLE_FILTER_BITS)];
+}
+
+/// @brief draws the bytes until the next sample from an exponential distribution, so sample points form a poisson process over allocated bytes
+static size_t memm_sample_next_interval()
+{
+    uint64_t x = t_memm_sample_random;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    t_memm_sample_random = x;
+
+    // xorshift64* output scaled to (0, 1)
+    double uniform = ((double)((x * 0x2545F4914F6CDD1Dull) >> 11) + 0.5) / 9007199254740992.0;
+    return (size_t)(-log(uniform) * (double)MEMM_SAMPLE_INTERVAL) + 1;
+}
+
+/// @brief decides whether an allocation is sampled, a subtraction and a predictable branch unless it is
+static bool memm_sample(size_t size)
+{
+    if (size < t_memm_sample_countdown) {
+        t_memm_sample_countdown -= size;
+        return false;
+    }
+
+    if (!t_memm_sample_random) {
+        // first allocation of the thread, the generator is seeded and the first interval drawn instead of sampling it
+        t_memm_sample_random = ((uint64_t)(size_t)&t_memm_sample_random ^ memm_clock_ticks() ^ 0x9E3779B97F4A7C15ull) | 1;
+        t_memm_sample_countdown = memm_sample_next_interval();
+        return memm_sample(size);
+    }
+
+    t_memm_sample_countdown = memm_sample_next_interval();
+    return true;
+}
+
+/// @brief returns how many allocations and bytes a sample stands for, a block of size bytes is sampled with probability 1 - e^(-size / MEMM_SAMPLE_INTERVAL)
+static void memm_sample_weight(size_t size, size_t* count, size_t* bytes)
+{
+    double probability = -expm1(-(double)size / (double)MEMM_SAMPLE_INTERVAL);
+    double weight = probability > 0.0 ? 1.0 / probability : 1.0;
+    *count = (size_t)(weight + 0.5);
+    *bytes = (size_t)(weight * (double)size + 0.5);
+}
+#endif
+
+/// @brief returns the shard responsible for a pointer, taken from the middle bits of a fibonacci product so it doesn't correlate with index slots
+static memm_shard_t* memm_shard_of(const void* ptr)
+{
+    #if MEMM_SHARD_COUNT == 1
+    (void)ptr;
+    return &g_memm.shards[0];
+    #else
+    uint64_t key = (uint64_t)(uintptr_t)ptr * 11400714819323198485ull;
+    return &g_memm.shards[(key >> 32) & (MEMM_SHARD_COUNT - 1)];
+    #endif
+}
+
+#ifdef MEMM_INLINE_HEADERS
+
+/// @brief bytes reserved before every user block, keeps user pointers 16-byte aligned
+#define MEMM_HEADER_SIZE ((sizeof(memm_allocation_t) + 15) & ~(size_t)15)
+
+/// @brief marks a header as belonging to a live tracked block, cleared on free to catch double frees
+#define MEMM_HEADER_MAGIC 0x4D454D40u
+
+/// @brief flags a header of an aligned block, preceded by the count of padding bytes between it and the start of the block, kept on free
+#define MEMM_HEADER_PADDED 4u
+
+/// @brief user pointers of every block allocated with a header, it outlives memm_init/memm_shutdown since those blocks may still be alive
+static memm_ptr_set_t g_memm_headers;
+
+/// @brief returns the tracking level of a block from its header
+#define memm_allocation_level(alloc) ((alloc)->magic & 3u)
+
+/// @brief returns the header of a block from its user pointer
+static memm_allocation_t* memm_header_of(void* ptr)
+{
+    return (memm_allocation_t*)((char*)ptr - MEMM_HEADER_SIZE);
+}
+
+/// @brief returns the user pointer of a tracked block
+static void* memm_allocation_ptr(memm_allocation_t* alloc)
+{
+    return (char*)alloc + MEMM_HEADER_SIZE;
+}
+
+/// @brief returns the start of the allocation holding a header, before its padding if it has any
+static void* memm_block_base(memm_allocation_t* header)
+{
+    return (header->magic & MEMM_HEADER_PADDED) ? (char*)header - ((size_t*)header)[-1] : (void*)header;
+}
+
+/// @brief allocates a block with room for its header, returning the user pointer
+static void* memm_block_malloc(size_t size)
+{
+    if (size > (size_t)-1 - MEMM_HEADER_SIZE) return NULL;
+
+    char* block = (char*)memm_system_malloc(MEMM_HEADER_SIZE + size);
+    if (!block) return NULL;
+
+    ((memm_allocation_t*)block)->magic = 0;
+    if (!memm_ptr_set_insert(&g_memm_headers, block + MEMM_HEADER_SIZE)) {
+        memm_system_free(block);
+        return NULL;
+    }
+    return block + MEMM_HEADER_SIZE;
+}
+
+/// @brief allocates a block aligned to a power of 2, padded so the header still sits right before the user pointer
+static void* memm_block_aligned_alloc(size_t alignment, size_t size)
+{
+    // the header size keeps user pointers aligned as much as malloc does
+    if (alignment <= MEMM_MALLOC_ALIGNMENT) return memm_block_malloc(size);
+
+    size_t offset = (MEMM_HEADER_SIZE + sizeof(size_t) + alignment - 1) & ~(alignment - 1);
+    if (size > (size_t)-1 - offset) return NULL;
+
+    char* block = (char*)memm_system_aligned_alloc(alignment, offset + size);
+    if (!block) return NULL;
+
+    memm_allocation_t* header = memm_header_of(block + offset);
+    ((size_t*)header)[-1] = (size_t)((char*)header - block);
+    header->magic = MEMM_HEADER_PADDED;
+    if (!memm_ptr_set_insert(&g_memm_headers, block + offset)) {
+        memm_system_free(block);
+        return NULL;
+    }
+    return block + offset;
+}
+
+/// @brief zeroed-allocates a block with room for its header, returning the user pointer
+static void* memm_block_calloc(size_t num, size_t size)
+{
+    if (size != 0 && num > ((size_t)-1 - MEMM_HEADER_SIZE) / size) return NULL;
+
+    char* block = (char*)memm_system_calloc(1, MEMM_HEADER_SIZE + num * size);
+    if (!block) return NULL;
+
+    if (!memm_ptr_set_insert(&g_memm_headers, block + MEMM_HEADER_SIZE)) {
+        memm_system_free(block);
+        return NULL;
+    }
+    return block + MEMM_HEADER_SIZE;
+}
+
+/// @brief deallocates a block together with its header and padding
+static void memm_block_free(void* ptr)
+{
+    memm_ptr_set_remove(&g_memm_headers, ptr);
+    memm_system_free(memm_block_base(memm_header_of(ptr)));
+}
+
+/// @brief resizes a block and its header, returning the new user pointer
+static void* memm_block_realloc(void* ptr, size_t size)
+{
+    if (!ptr) return memm_block_malloc(size);
+    if (size > (size_t)-1 - MEMM_HEADER_SIZE) return NULL;
+
+    // like the system realloc, a resized aligned block loses its alignment, and with it the padding
+    memm_allocation_t* header = memm_header_of(ptr);
+    if (header->magic & MEMM_HEADER_PADDED) {
+        char* new_ptr = (char*)memm_block_malloc(size);
+        if (!new_ptr) return NULL;
+
+        memcpy(new_ptr - MEMM_HEADER_SIZE, header, MEMM_HEADER_SIZE + (size < header->size ? size : header->size));
+        memm_header_of(new_ptr)->magic &= ~MEMM_HEADER_PADDED;
+        memm_block_free(ptr);
+        return new_ptr;
+    }
+
+    // the shard stays locked while the allocator may release the old address, so no other block can be listed at it meanwhile
+    memm_ptr_shard_t* shard = memm_ptr_set_lock(&g_memm_headers, ptr);
+    char* block = (char*)memm_system_realloc(header, MEMM_HEADER_SIZE + size);
+    char* new_ptr = block ? block + MEMM_HEADER_SIZE : NULL;
+    if (!memm_ptr_set_move(&g_memm_headers, shard, ptr, new_ptr)) {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: Failed to list the moved block %p\n", (void*)new_ptr);
+        #endif
+    }
+    return new_ptr;
+}
+
+/// @brief tells whether a block was allocated with a header that is still marked, the header is only read once the block is known to have one
+static bool memm_has_header(void* ptr)
+{
+    return memm_ptr_set_contains(&g_memm_headers, ptr) && (memm_header_of(ptr)->magic & ~(3u | MEMM_HEADER_PADDED)) == MEMM_HEADER_MAGIC;
+}
+
+/// @brief returns the header of a block if memm is tracking it, blocks tracked before the last memm_init keep a header but aren't
+static memm_allocation_t* memm_tracked_header(void* ptr)
+{
+    memm_allocation_t* header = memm_header_of(ptr);
+    return memm_has_header(ptr) && header->session == g_memm_session ? header : NULL;
+}
+
+/// @brief tells whether a block memm doesn't track kept its header from before the last memm_init, until a reset there are none so blocks from libc skip the second lookup
+static bool memm_stale_header(void* ptr)
+{
+    return g_memm_session != 0 && memm_has_header(ptr);
+}
+
+/// @brief adds a fully tracked block to the live list of a shard whose lock is held
+static void memm_live_insert(memm_shard_t* shard, memm_allocation_t* alloc)
+{
+    alloc->prev = NULL;
+    alloc->next = shard->live;
+    if (shard->live) {
+        shard->live->prev = alloc;
+    }
+    shard->live = alloc;
+}
+
+/// @brief removes a fully tracked block from the live list of a shard whose lock is held
+static void memm_live_remove(memm_shard_t* shard, memm_allocation_t* alloc)
+{
+    if (alloc->prev) {
+        alloc->prev->next = alloc->next;
+    }
+
+    else {
+        shard->live = alloc->next;
+    }
+
+    if (alloc->next) {
+        alloc->next->prev = alloc->prev;
+    }
+}
+
+/// @brief adds a fully tracked block to the live list of its shard
+static void memm_live_link(memm_allocation_t* alloc)
+{
+    memm_shard_t* shard = memm_shard_of(memm_allocation_ptr(alloc));
+    memm_lock_acquire(&shard->lock);
+    memm_live_insert(shard, alloc);
+    memm_lock_release(&shard->lock);
+}
+
+/// @brief removes a fully tracked block from the live list of its shard
+static void memm_live_unlink(memm_allocation_t* alloc)
+{
+    memm_shard_t* shard = memm_shard_of(memm_allocation_ptr(alloc));
+    memm_lock_acquire(&shard->lock);
+    memm_live_remove(shard, alloc);
+    memm_lock_release(&shard->lock);
+}
+
+#else
+
+/// @brief returns the user pointer of a tracked block
+static void* memm_allocation_ptr(memm_allocation_t* alloc)
+{
+    return alloc->ptr;
+}
+
+/// @brief allocates a block, returning the user pointer
+static void* memm_block_malloc(size_t size)
+{
+    return memm_system_malloc(size);
+}
+
+/// @brief zeroed-allocates a block, returning the user pointer
+static void* memm_block_calloc(size_t num, size_t size)
+{
+    return memm_system_calloc(num, size);
+}
+
+/// @brief allocates a block aligned to a power of 2, returning the user pointer
+static void* memm_block_aligned_alloc(size_t alignment, size_t size)
+{
+    return alignment <= MEMM_MALLOC_ALIGNMENT ? memm_system_malloc(size) : memm_system_aligned_alloc(alignment, size);
+}
+
+/// @brief resizes a block, returning the new user pointer
+static void* memm_block_realloc(void* ptr, size_t size)
+{
+    return memm_system_realloc(ptr, size);
+}
+
+/// @brief deallocates a block
+static void memm_block_free(void* ptr)
+{
+    memm_system_free(ptr);
+}
+
+/// @brief marks a slot of the previous table whose entry was migrated or removed, probing continues past it
+#define MEMM_SLOT_TOMBSTONE ((const void*)(size_t)1)
+
+/// @brief how many slots of the previous table are migrated on every insertion
+#define MEMM_INDEX_MIGRATE_STEP 8
+
+/// @brief hashes a pointer into a slot of a table with 2^bits slots
+static size_t memm_hash_ptr(const void* ptr, unsigned bits)
+{
+    uint64_t key = (uint64_t)(uintptr_t)ptr;
+    
+    // a single slot table would shift by 64 below
+    if (bits == 0) return 0;
+
+    #if MEMM_HASH_FUNCTION == MEMM_HASH_FIBONACCI
+    // multiplying by 2^64/phi spreads every input bit into the high bits, wich are the ones kept
+    return (size_t)((key * 11400714819323198485ull) >> (64 - bits));
+    #elif MEMM_HASH_FUNCTION == MEMM_HASH_FMIX64
+    // murmur3 64-bit finalizer, full avalanche at the cost of two multiplications
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return (size_t)(key & (((uint64_t)1 << bits) - 1));
+    #else
+    // plain low-bit masking, aligned pointers leave most home slots unused
+    return (size_t)(key & (((uint64_t)1 << bits) - 1));
+    #endif
+}
+
+/// @brief returns how far a slot is from the home slot of the key it holds
+static size_t memm_index_distance(const memm_index_t* index, size_t slot)
+{
+    size_t mask = index->capacity - 1;
+    return (slot - memm_hash_ptr(index->slots[slot].ptr, index->bits)) & mask;
+}
+
+/// @brief places an entry on the current table, displacing entries closer to their home slot (robin hood)
+static void memm_index_place(memm_index_t* index, const void* ptr, memm_allocation_t* alloc)
+{
+    size_t mask = index->capacity - 1;
+    size_t slot = memm_hash_ptr(ptr, index->bits);
+    size_t distance = 0;
+    memm_slot_t entry = { ptr, alloc };
+
+    for (;;) {
+        if (!index->slots[slot].ptr) {
+            index->slots[slot] = entry;
+            index->count++;
+            return;
+        }
+
+        size_t resident_distance = memm_index_distance(index, slot);
+        if (resident_distance < distance) {
+            memm_slot_t displaced = index->slots[slot];
+            index->slots[slot] = entry;
+            entry = displaced;
+            distance = resident_distance;
+        }
+        slot = (slot + 1) & mask;
+        distance++;
+    }
+}
+
+/// @brief moves up to step live entries from the previous table into the current one, releasing it once empty
+static void memm_index_migrate(memm_index_t* index, size_t step)
+{
+    while (index->old_slots && step-- > 0) {
+        if (index->migrate_cursor >= index->old_capacity || index->old_count == 0) {
+            memm_libc_free(index->old_slots);
+            index->old_slots = NULL;
+            index->old_capacity = 0;
+            index->old_bits = 0;
+            index->old_count = 0;
+            index->migrate_cursor = 0;
+            return;
+        }
+
+        memm_slot_t* slot = &index->old_slots[index->migrate_cursor++];
+        if (slot->ptr && slot->ptr != MEMM_SLOT_TOMBSTONE) {
+            memm_index_place(index, slot->ptr, slot->alloc);
+            slot->ptr = MEMM_SLOT_TOMBSTONE;
+            index->old_count--;
+        }
+    }
+}
+
+/// @brief doubles the current table, the old one is drained incrementally by later insertions
+static bool memm_index_grow(memm_index_t* index)
+{
+    // a grow never starts before the previous one has been fully drained
+    if (index->old_slots) {
+        memm_index_migrate(index, (size_t)-1);
+    }
+
+    unsigned bits = index->bits + 1;
+    if (index->capacity == 0) {
+        // at least 2 slots, so the first insertion never finds the table full
+        for (bits = 1; ((size_t)1 << bits) < MEMM_HASH_TABLE_SIZE; bits++);
+    }
+
+    size_t capacity = (size_t)1 << bits;
+    memm_slot_t* slots = (memm_slot_t*)memm_libc_calloc(capacity, sizeof(memm_slot_t));
+    if (!slots) {
+        return false;
+    }
+
+    index->old_slots = index->slots;
+    index->old_capacity = index->capacity;
+    index->old_bits = index->bits;
+    index->old_count = index->count;
+    index->migrate_cursor = 0;
+    index->slots = slots;
+    index->capacity = capacity;
+    index->bits = bits;
+    index->count = 0;
+    return true;
+}
+
+/// @brief inserts a pointer into the index
+static bool memm_index_insert(memm_index_t* index, const void* ptr, memm_allocation_t* alloc)
+{
+    // keeps the load factor under 3/4, the draining pace guarantees the previous table is empty before the next grow
+    if ((index->count + index->old_count + 1) * 4 > index->capacity * 3) {
+        if (!memm_index_grow(index)) {
+            return false;
+        }
+    }
+
+    memm_index_migrate(index, MEMM_INDEX_MIGRATE_STEP);
+    memm_index_place(index, ptr, alloc);
+    return true;
+}
+
+#if !defined(MEMM_THREAD_SAFE) && !defined(MEMM_SAMPLING)
+/// @brief returns the slot a pointer is mapped to, in the current or the previous table, or null
+static memm_slot_t* memm_index_find(memm_index_t* index, const void* ptr)
+{
+    if (index->capacity == 0) {
+        return NULL;
+    }
+
+    size_t mask = index->capacity - 1;
+    size_t slot = memm_hash_ptr(ptr, index->bits);
+    for (size_t distance = 0; index->slots[slot].ptr; distance++) {
+        if (index->slots[slot].ptr == ptr) {
+            return &index->slots[slot];
+        }
+
+        if (memm_index_distance(index, slot) < distance) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (index->old_slots) {
+        mask = index->old_capacity - 1;
+        slot = memm_hash_ptr(ptr, index->old_bits);
+        while (index->old_slots[slot].ptr) {
+            if (index->old_slots[slot].ptr == ptr) {
+                return &index->old_slots[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    return NULL;
+}
+#endif
+
+/// @brief removes a pointer from the index, returning the allocation it was mapped to
+static memm_allocation_t* memm_index_remove(memm_index_t* index, const void* ptr)
+{
+    if (index->capacity == 0) {
+        return NULL;
+    }
+
+    size_t mask = index->capacity - 1;
+    size_t slot = memm_hash_ptr(ptr, index->bits);
+    for (size_t distance = 0; index->slots[slot].ptr; distance++) {
+        if (index->slots[slot].ptr == ptr) {
+            memm_allocation_t* alloc = index->slots[slot].alloc;
+
+            // backward-shift the following entries so no tombstones are needed on the current table
+            size_t next = (slot + 1) & mask;
+            while (index->slots[next].ptr && memm_index_distance(index, next) > 0) {
+                index->slots[slot] = index->slots[next];
+                slot = next;
+                next = (next + 1) & mask;
+            }
+            index->slots[slot].ptr = NULL;
+            index->slots[slot].alloc = NULL;
+            index->count--;
+            return alloc;
+        }
+
+        // robin hood invariant: the key would have displaced any entry closer to its home
+        if (memm_index_distance(index, slot) < distance) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (index->old_slots) {
+        mask = index->old_capacity - 1;
+        slot = memm_hash_ptr(ptr, index->old_bits);
+        while (index->old_slots[slot].ptr) {
+            if (index->old_slots[slot].ptr == ptr) {
+                memm_allocation_t* alloc = index->old_slots[slot].alloc;
+                index->old_slots[slot].ptr = MEMM_SLOT_TOMBSTONE;
+                index->old_count--;
+                return alloc;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    return NULL;
+}
+
+/// @brief returns the i-th slot across the current and previous tables, or null if it holds no live entry
+static memm_slot_t* memm_index_slot(memm_index_t* index, size_t i)
+{
+    memm_slot_t* slot = i < index->capacity ? &index->slots[i] : &index->old_slots[i - index->capacity];
+    return (slot->ptr && slot->ptr != MEMM_SLOT_TOMBSTONE) ? slot : NULL;
+}
+
+/// @brief returns how many slots memm_index_slot may be queried with
+static size_t memm_index_span(const memm_index_t* index)
+{
+    return index->capacity + (index->old_slots ? index->old_capacity : 0);
+}
+
+/// @brief returns the name of the hash function in use
+static const char* memm_hash_name()
+{
+    #if MEMM_HASH_FUNCTION == MEMM_HASH_FIBONACCI
+    return "fibonacci";
+    #elif MEMM_HASH_FUNCTION == MEMM_HASH_FMIX64
+    return "fmix64";
+    #else
+    return "mask";
+    #endif
+}
+
+/// @brief returns the capacity of the indexes of all shards together
+static size_t memm_index_total_capacity()
+{
+    size_t capacity = 0;
+    for (size_t i = 0; i < MEMM_SHARD_COUNT; i++) {
+        memm_lock_acquire(&g_memm.shards[i].lock);
+        capacity += g_memm.shards[i].index.capacity;
+        memm_lock_release(&g_memm.shards[i].lock);
+    }
+    return capacity;
+}
+
+/// @brief releases both tables
+static void memm_index_release(memm_index_t* index)
+{
+    memm_libc_free(index->slots);
+    memm_libc_free(index->old_slots);
+    memset(index, 0, sizeof(*index));
+}
+
+#endif
+
+/// @brief bytes reserved at the start of a slab, keeps the objects 16-byte aligned
+#define MEMM_SLAB_HEADER_SIZE ((sizeof(memm_slab_t) + 15) & ~(size_t)15)
+
+/// @brief sets up an empty pool, no memory is reserved until the first object is requested
+static void memm_slab_pool_init(memm_slab_pool_t* pool, size_t object_size, size_t objects_per_slab)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->object_size = (object_size < sizeof(void*) ? sizeof(void*) : object_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    pool->objects_per_slab = objects_per_slab ? objects_per_slab : 1;
+}
+
+/// @brief takes an object from the pool, allocating a new slab only when both the free list and the newest slab are exhausted
+static void* memm_slab_pool_get(memm_slab_pool_t* pool)
+{
+    if (pool->free_list) {
+        void* object = pool->free_list;
+        pool->free_list = *(void**)object;
+        return object;
+    }
+
+    if (pool->bump == pool->bump_end) {
+        size_t bytes = MEMM_SLAB_HEADER_SIZE + pool->object_size * pool->objects_per_slab;
+        memm_slab_t* slab = (memm_slab_t*)memm_libc_malloc(bytes);
+        if (!slab) {
+            return NULL;
+        }
+
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->slab_count++;
+        pool->bump = (char*)slab + MEMM_SLAB_HEADER_SIZE;
+        pool->bump_end = (char*)slab + bytes;
+    }
+
+    void* object = pool->bump;
+    pool->bump += pool->object_size;
+    return object;
+}
+
+/// @brief returns an object to the pool
+static void memm_slab_pool_put(memm_slab_pool_t* pool, void* object)
+{
+    *(void**)object = pool->free_list;
+    pool->free_list = object;
+}
+
+/// @brief frees every slab at once, invalidating all objects handed out by the pool
+static void memm_slab_pool_release(memm_slab_pool_t* pool)
+{
+    while (pool->slabs) {
+        memm_slab_t* next = pool->slabs->next;
+        memm_libc_free(pool->slabs);
+        pool->slabs = next;
+    }
+    memm_slab_pool_init(pool, pool->object_size, pool->objects_per_slab);
+}
+
+#ifndef MEMM_INLINE_HEADERS
+/// @brief index values with the lowest bit set are light entries, the size, callsite and level of a block packed in place of a record pointer
+#define memm_is_light(alloc) (((uintptr_t)(alloc) & 1) != 0)
+
+#ifndef MEMM_SAMPLING
+/// @brief packs a block into a light entry, returns false when it doesn't fit and needs a record
+static bool memm_light_pack(size_t size, uint32_t callsite, size_t level, memm_allocation_t** entry)
+{
+    #if UINTPTR_MAX > 0xFFFFFFFFu
+    // 38 bits of size, 24 bits of callsite, a bit telling the callsites level apart from the counters one and the tag
+    if ((uint64_t)size >> 38 || callsite >> 24) return false;
+    *entry = (memm_allocation_t*)(uintptr_t)(((uint64_t)size << 26) | ((uint64_t)callsite << 2) | ((uint64_t)(level == MEMM_LEVEL_CALLSITES) << 1) | 1);
+    return true;
+    #else
+    (void)size;
+    (void)callsite;
+    (void)level;
+    (void)entry;
+    return false;
+    #endif
+}
+#endif
+
+/// @brief unpacks a light entry
+static void memm_light_unpack(memm_allocation_t* entry, size_t* size, uint32_t* callsite, size_t* level)
+{
+    uint64_t value = (uint64_t)(uintptr_t)entry;
+    *size = (size_t)(value >> 26);
+    *callsite = (uint32_t)(value >> 2) & 0xFFFFFFu;
+    *level = (value & 2) ? MEMM_LEVEL_CALLSITES : MEMM_LEVEL_COUNTERS;
+}
+#endif
+
+/// @brief hands out a block at the off level, memm doesn't keep anything about it
+static void* memm_passthrough(void* ptr, size_t size)
+{
+    if (!ptr) return NULL;
+
+    #ifdef MEMM_SAMPLING
+    // frees of blocks without a record are always counted with their usable size, so the allocation has to be too
+    memm_counters_count_allocation(size, 1, memm_system_usable_size(ptr));
+    #else
+    (void)size;
+    if (!memm_atomic_load(&g_memm.untracked_blocks)) {
+        memm_atomic_store(&g_memm.untracked_blocks, 1);
+    }
+    #endif
+    return ptr;
+}
+
+/// @brief returns the name of a tracking level
+static const char* memm_level_name(size_t level)
+{
+    static const char* names[] = { "off", "counters", "callsites", "full" };
+    return level < sizeof(names) / sizeof(names[0]) ? names[level] : "unknown";
+}
+
+#if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+/// @brief returns how many nanoseconds a clock tick lasts
+static double memm_clock_ns_per_tick()
+{
+    #if MEMM_CLOCK_SOURCE == MEMM_CLOCK_CYCLES && defined(MEMM_CLOCK_CALIBRATED)
+    // the longer since memm_init the more precise the ratio, so it is measured when needed instead of spinning at startup
+    uint64_t reference = memm_clock_reference_ns();
+    while (reference - g_memm.clock_anchor_ns < MEMM_CLOCK_CALIBRATION_NS) {
+        reference = memm_clock_reference_ns();
+    }
+    uint64_t ticks = memm_clock_ticks() - g_memm.clock_anchor_ticks;
+    return ticks ? (double)(reference - g_memm.clock_anchor_ns) / (double)ticks : 0.0;
+    #elif MEMM_CLOCK_SOURCE == MEMM_CLOCK_CYCLES
+    uint64_t frequency;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(frequency));
+    return frequency ? 1e9 / (double)frequency : 0.0;
+    #elif MEMM_CLOCK_SOURCE == MEMM_CLOCK_COARSE && (defined(_WIN32) || defined(_WIN64))
+    return 1e6;
+    #else
+    return 1.0;
+    #endif
+}
+#endif
+
+/// @brief returns the name of the clock source in use
+static const char* memm_clock_name()
+{
+    #if MEMM_CLOCK_SOURCE == MEMM_CLOCK_CYCLES
+    return "cycle counter";
+    #elif MEMM_CLOCK_SOURCE == MEMM_CLOCK_COARSE
+    return "coarse monotonic";
+    #else
+    return "disabled";
+    #endif
+}
+
+/// @brief iterates over every live allocation shard by shard, in index order or in the intrusive list order with MEMM_INLINE_HEADERS
+typedef struct memm_cursor
+{
+    size_t shard;               // shard being visited, its lock is held while the cursor is inside it
+    size_t position;            // position inside the shard, 0 before its first allocation
+    memm_allocation_t* current;
+} memm_cursor_t;
+
+/// @brief advances the cursor, returning null once every live allocation was visited and every lock released
+static memm_allocation_t* memm_cursor_next(memm_cursor_t* cursor)
+{
+    for (; cursor->shard < MEMM_SHARD_COUNT; cursor->shard++, cursor->position = 0) {
+        memm_shard_t* shard = &g_memm.shards[cursor->shard];
+        if (cursor->position == 0) {
+            memm_lock_acquire(&shard->lock);
+        }
+
+        #ifdef MEMM_INLINE_HEADERS
+        cursor->current = cursor->position++ == 0 ? shard->live : cursor->current->next;
+        if (cursor->current) {
+            return cursor->current;
+        }
+        #else
+        while (cursor->position < memm_index_span(&shard->index)) {
+            memm_slot_t* slot = memm_index_slot(&shard->index, cursor->position++);
+            if (slot && !memm_is_light(slot->alloc)) {
+                return cursor->current = slot->alloc;
+            }
+        }
+        #endif
+        memm_lock_release(&shard->lock);
+    }
+    return cursor->current = NULL;
+}
+
+/// @brief stops a cursor before it reached the end, releasing the lock of the shard it is in
+static void memm_cursor_stop(memm_cursor_t* cursor)
+{
+    if (cursor->shard < MEMM_SHARD_COUNT && cursor->position > 0) {
+        memm_lock_release(&g_memm.shards[cursor->shard].lock);
+    }
+    cursor->shard = MEMM_SHARD_COUNT;
+}
+
+/// @brief register an allocation at the current tracking level
+static void memm_register_allocation(void* ptr, size_t size, uint32_t callsite)
+{
+    if (!ptr) return;
+    
+    size_t level = memm_atomic_load(&g_memm_level);
+    #ifdef MEMM_INLINE_HEADERS
+    // a block with a header has to stay recognizable, so it is tracked at least at the counters level
+    if (level == MEMM_LEVEL_OFF) {
+        level = MEMM_LEVEL_COUNTERS;
+    }
+
+    memm_allocation_t* alloc = memm_header_of(ptr);
+    alloc->size = size;
+    alloc->callsite = callsite;
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    alloc->timestamp = level == MEMM_LEVEL_FULL ? memm_clock_ticks() : 0;
+    #endif
+    alloc->magic = MEMM_HEADER_MAGIC | (alloc->magic & MEMM_HEADER_PADDED) | (uint32_t)level;
+    alloc->session = g_memm_session;
+    alloc->prev = NULL;
+    alloc->next = NULL;
+
+    // only blocks at the full level are listed, the others don't take the lock at all
+    if (level == MEMM_LEVEL_FULL) {
+        memm_live_link(alloc);
+    }
+    #else
+    if (level == MEMM_LEVEL_OFF) {
+        memm_passthrough(ptr, size);
+        return;
+    }
+
+    memm_shard_t* shard = memm_shard_of(ptr);
+
+    #ifdef MEMM_SAMPLING
+    // unsampled blocks get no record, their bytes are counted as the usable size the matching free can find again, so sampled ones are too
+    if (level == MEMM_LEVEL_COUNTERS || !memm_sample(size)) {
+        memm_counters_count_allocation(size, 1, memm_system_usable_size(ptr));
+        return;
+    }
+    #else
+    // below the full level the block fits in the index slot itself, no record is taken
+    memm_allocation_t* entry = NULL;
+    if (level != MEMM_LEVEL_FULL && memm_light_pack(size, callsite, level, &entry)) {
+        memm_lock_acquire(&shard->lock);
+        bool inserted = memm_index_insert(&shard->index, ptr, entry);
+        if (inserted) {
+            memm_atomic_store(&shard->tracked, shard->tracked + 1);
+        }
+        memm_lock_release(&shard->lock);
+
+        if (inserted) {
+            memm_count_allocation(size, callsite, level);
+        }
+
+        else {
+            #ifdef MEMM_ENABLE_LOGGING
+            fprintf(stderr, "MEMM-ERROR: Failed to register allocation for %p\n", ptr);
+            #endif
+            memm_passthrough(ptr, size);
+        }
+        return;
+    }
+    #endif
+
+    memm_lock_acquire(&shard->lock);
+    if (!shard->records.object_size) {
+        memm_slab_pool_init(&shard->records, sizeof(memm_allocation_t), MEMM_RECORD_SLAB_SIZE);
+    }
+
+    memm_allocation_t* alloc = (memm_allocation_t*)memm_slab_pool_get(&shard->records);
+    
+    if (!alloc || !memm_index_insert(&shard->index, ptr, alloc)) {
+        if (alloc) {
+            memm_slab_pool_put(&shard->records, alloc);
+        }
+        memm_lock_release(&shard->lock);
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: Failed to register allocation for %p\n", ptr);
+        #endif
+        memm_passthrough(ptr, size);
+        return;
+    }
+    
+    alloc->ptr = ptr;
+    alloc->size = size;
+    alloc->callsite = callsite;
+    alloc->level = (uint32_t)level;
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    alloc->timestamp = memm_clock_ticks();
+    #endif
+    memm_atomic_store(&shard->tracked, shard->tracked + 1);
+    memm_lock_release(&shard->lock);
+
+    #ifdef MEMM_SAMPLING
+    memm_atomic_add(memm_sample_filter_of(ptr), 1);
+    size_t count, bytes;
+    memm_sample_weight(size, &count, &bytes);
+    memm_callsite_count_allocation(callsite, count, bytes);
+    memm_counters_count_allocation(size, 1, memm_system_usable_size(ptr));
+    return;
+    #endif
+    #endif
+    
+    memm_count_allocation(size, callsite, level);
+}
+
+/// @brief size passed by frees that don't know the size of the block, nothing is checked
+#define MEMM_UNKNOWN_SIZE ((size_t)-1)
+
+/// @brief reports a sized free that doesn't match the size of the block
+static void memm_check_size(void* ptr, size_t size, size_t block_size, const char* file, int line)
+{
+    if (size == MEMM_UNKNOWN_SIZE || size == block_size) return;
+
+    memm_atomic_add(&g_memm.size_mismatches, 1);
+    #ifdef MEMM_ENABLE_LOGGING
+    fprintf(stderr, "MEMM-ERROR: Sized free of %p with %zu bytes, but the block has %zu bytes (%s:%d)\n", ptr, size, block_size, file, line);
+    #else
+    (void)ptr;
+    (void)file;
+    (void)line;
+    #endif
+}
+
+/// @brief unregister the allocation at the level it was allocated with, size is checked unless it is MEMM_UNKNOWN_SIZE, returns false for blocks memm doesn't track without reporting them
+static bool memm_unregister_allocation(void* ptr, size_t size, const char* file, int line)
+{
+    if (!ptr) return true;
+    
+    #ifdef MEMM_INLINE_HEADERS
+    memm_allocation_t* to_free = memm_tracked_header(ptr);
+    if (to_free) {
+        size_t level = memm_allocation_level(to_free);
+        memm_check_size(ptr, size, to_free->size, file, line);
+        to_free->magic &= MEMM_HEADER_PADDED;
+        if (level == MEMM_LEVEL_FULL) {
+            memm_live_unlink(to_free);
+        }
+
+        memm_count_free(to_free->size, to_free->callsite, memm_allocation_timestamp(to_free), level);
+        return true;
+    }
+    #else
+    #ifdef MEMM_SAMPLING
+    // nothing sampled maps to this filter slot, so the block has no record and the index isn't probed
+    size_t* filter = memm_sample_filter_of(ptr);
+    if (memm_atomic_load(filter) == 0) {
+        size_t usable = memm_system_usable_size(ptr);
+        // only the usable size is known, a sized free can at most be caught passing more than that
+        if (size != MEMM_UNKNOWN_SIZE && size > usable) {
+            memm_check_size(ptr, size, usable, file, line);
+        }
+        memm_counters_count_free(1, usable);
+        return true;
+    }
+    #endif
+
+    // a shard without entries can't know the block, whatever level it was allocated with
+    memm_shard_t* shard = memm_shard_of(ptr);
+    memm_allocation_t* to_free = NULL;
+    if (memm_atomic_load(&shard->tracked) > 0) {
+        memm_lock_acquire(&shard->lock);
+        to_free = memm_index_remove(&shard->index, ptr);
+        if (to_free) {
+            memm_atomic_store(&shard->tracked, shard->tracked - 1);
+        }
+
+        if (to_free && memm_is_light(to_free)) {
+            memm_lock_release(&shard->lock);
+
+            size_t block_size, level;
+            uint32_t callsite;
+            memm_light_unpack(to_free, &block_size, &callsite, &level);
+            memm_check_size(ptr, size, block_size, file, line);
+            memm_count_free(block_size, callsite, 0, level);
+            return true;
+        }
+
+        if (to_free) {
+            size_t block_size = to_free->size;
+            uint32_t callsite = to_free->callsite;
+            size_t level = to_free->level;
+            uint64_t timestamp = memm_allocation_timestamp(to_free);
+            memm_slab_pool_put(&shard->records, to_free);
+            memm_lock_release(&shard->lock);
+
+            memm_check_size(ptr, size, block_size, file, line);
+            #ifdef MEMM_SAMPLING
+            (void)level;
+            memm_atomic_add(filter, (size_t)-1);
+            size_t count, bytes;
+            memm_sample_weight(block_size, &count, &bytes);
+            memm_callsite_count_free(callsite, count, bytes, timestamp);
+            memm_counters_count_free(1, memm_system_usable_size(ptr));
+            #else
+            memm_count_free(block_size, callsite, timestamp, level);
+            #endif
+            return true;
+        }
+        memm_lock_release(&shard->lock);
+    }
+
+    #ifdef MEMM_SAMPLING
+    // a filter false positive, the block simply wasn't sampled
+    size_t usable = memm_system_usable_size(ptr);
+    if (size != MEMM_UNKNOWN_SIZE && size > usable) {
+        memm_check_size(ptr, size, usable, file, line);
+    }
+    memm_counters_count_free(1, usable);
+    return true;
+    #endif
+    #endif
+    return false;
+}
+
+/// @brief releases a block memm doesn't know straight to the allocator, reported only while every block was handed out tracked
+static void memm_free_untracked(void* ptr, const char* file, int line)
+{
+    memm_atomic_add(&g_memm.untracked_frees, 1);
+    #ifdef MEMM_ENABLE_LOGGING
+    if (!memm_atomic_load(&g_memm.untracked_blocks)) {
+        fprintf(stderr, "MEMM-WARN: free on an untracked memory %p (%s:%d)\n", ptr, file, line);
+    }
+    #else
+    (void)file;
+    (void)line;
+    #endif
+
+    #ifdef MEMM_INLINE_HEADERS
+    // a block tracked before the last memm_init still starts at its header
+    if (memm_stale_header(ptr)) {
+        memm_header_of(ptr)->magic &= MEMM_HEADER_PADDED;
+        memm_block_free(ptr);
+        return;
+    }
+    #endif
+    memm_system_free(ptr);
+}
+
+#ifdef MEMM_INLINE_HEADERS
+/// @brief resizes a tracked block, its header travels with it so the tracking is updated in place, returns false for blocks memm doesn't track
+static bool memm_resize_allocation(void* ptr, size_t size, uint32_t callsite, void** new_ptr)
+{
+    memm_allocation_t* header = memm_tracked_header(ptr);
+    if (!header) return false;
+
+    size_t level = memm_allocation_level(header);
+    size_t old_size = header->size;
+    uint32_t old_callsite = header->callsite;
+    uint64_t timestamp = memm_allocation_timestamp(header);
+
+    // the list links point at the header, so a listed block leaves the list while the allocator may move it
+    if (level == MEMM_LEVEL_FULL) {
+        memm_live_unlink(header);
+    }
+
+    *new_ptr = memm_block_realloc(ptr, size);
+    if (*new_ptr) {
+        header = memm_header_of(*new_ptr);
+        header->size = size;
+        #ifdef MEMM_REALLOC_KEEPS_ORIGIN
+        (void)callsite;
+        #else
+        header->callsite = callsite;
+        #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+        header->timestamp = level == MEMM_LEVEL_FULL ? memm_clock_ticks() : 0;
+        #endif
+        #endif
+        memm_count_resize(old_size, old_callsite, timestamp, size, header->callsite, level);
+    }
+
+    // on failure the old block is still valid, along with its header
+    if (level == MEMM_LEVEL_FULL) {
+        memm_live_link(header);
+    }
+    return true;
+}
+#else
+/// @brief resizes a tracked block reusing its index entry, updated in place when the allocator didn't move the block, returns false for blocks memm doesn't track
+static bool memm_resize_allocation(void* ptr, size_t size, uint32_t callsite, void** new_ptr)
+{
+    #ifdef MEMM_SAMPLING
+    // the weight of a sample depends on the size it was drawn at, so sampled blocks are unregistered and registered again
+    (void)ptr;
+    (void)size;
+    (void)callsite;
+    (void)new_ptr;
+    return false;
+    #else
+    memm_shard_t* shard = memm_shard_of(ptr);
+    if (memm_atomic_load(&shard->tracked) == 0) return false;
+
+    memm_lock_acquire(&shard->lock);
+    #ifdef MEMM_THREAD_SAFE
+    // the allocator may hand the old address to another thread before the resize is over, so the entry leaves the index meanwhile
+    memm_allocation_t* entry = memm_index_remove(&shard->index, ptr);
+    if (entry) {
+        memm_atomic_store(&shard->tracked, shard->tracked - 1);
+    }
+    #else
+    memm_slot_t* slot = memm_index_find(&shard->index, ptr);
+    memm_allocation_t* entry = slot ? slot->alloc : NULL;
+    #endif
+    memm_lock_release(&shard->lock);
+    if (!entry) return false;
+
+    size_t old_size, level;
+    uint32_t old_callsite;
+    uint64_t timestamp = 0;
+    if (memm_is_light(entry)) {
+        memm_light_unpack(entry, &old_size, &old_callsite, &level);
+    }
+
+    else {
+        old_size = entry->size;
+        old_callsite = entry->callsite;
+        level = entry->level;
+        timestamp = memm_allocation_timestamp(entry);
+    }
+
+    #ifdef MEMM_REALLOC_KEEPS_ORIGIN
+    uint32_t new_callsite = old_callsite;
+    #else
+    uint32_t new_callsite = callsite;
+    #endif
+
+    *new_ptr = memm_block_realloc(ptr, size);
+    bool rehome = *new_ptr && memm_is_light(entry) && !memm_light_pack(size, new_callsite, level, &entry);
+    if (!*new_ptr && size > 0) {
+        // the old block is still valid, it keeps its entry as it was
+        #ifndef MEMM_THREAD_SAFE
+        return true;
+        #endif
+    }
+
+    else if (!*new_ptr || rehome) {
+        // the block was freed by a zero-sized realloc, or grew too large for a light entry and is tracked again from scratch
+        #ifndef MEMM_THREAD_SAFE
+        memm_index_remove(&shard->index, slot->ptr);
+        shard->tracked--;
+        #endif
+        if (!memm_is_light(entry)) {
+            memm_lock_acquire(&shard->lock);
+            memm_slab_pool_put(&shard->records, entry);
+            memm_lock_release(&shard->lock);
+        }
+
+        memm_count_free(old_size, old_callsite, timestamp, level);
+        memm_register_allocation(*new_ptr, size, callsite);
+        return true;
+    }
+
+    else if (!memm_is_light(entry)) {
+        entry->ptr = *new_ptr;
+        entry->size = size;
+        entry->callsite = new_callsite;
+        #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE && !defined(MEMM_REALLOC_KEEPS_ORIGIN)
+        entry->timestamp = memm_clock_ticks();
+        #endif
+    }
+
+    void* target = *new_ptr ? *new_ptr : ptr;
+    #ifndef MEMM_THREAD_SAFE
+    if (target == slot->ptr) {
+        // the index wasn't touched during the resize, so the slot still maps the block
+        slot->alloc = entry;
+        memm_count_resize(old_size, old_callsite, timestamp, size, new_callsite, level);
+        return true;
+    }
+
+    memm_index_remove(&shard->index, slot->ptr);
+    shard->tracked--;
+    #endif
+
+    // the entry moves to the shard of the new address, a record goes back to the pool of whichever shard it is in when freed
+    memm_shard_t* target_shard = memm_shard_of(target);
+    memm_lock_acquire(&target_shard->lock);
+    bool inserted = memm_index_insert(&target_shard->index, target, entry);
+    if (inserted) {
+        memm_atomic_store(&target_shard->tracked, target_shard->tracked + 1);
+    }
+
+    else if (!memm_is_light(entry)) {
+        memm_slab_pool_put(&target_shard->records, entry);
+    }
+    memm_lock_release(&target_shard->lock);
+
+    if (!inserted) {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: Failed to register allocation for %p\n", target);
+        #endif
+        memm_count_free(old_size, old_callsite, timestamp, level);
+        memm_passthrough(target, size);
+    }
+
+    else if (*new_ptr) {
+        memm_count_resize(old_size, old_callsite, timestamp, size, new_callsite, level);
+    }
+    return true;
+    #endif
+}
+#endif
+
+#ifndef MEMM_SAMPLING
+/// @brief counts how many blocks of a batch fall into every shard, so each shard lock is taken once per batch
+static void memm_batch_shards(void** ptrs, size_t count, size_t* pending)
+{
+    memset(pending, 0, MEMM_SHARD_COUNT * sizeof(size_t));
+    for (size_t i = 0; i < count; i++) {
+        if (ptrs[i]) {
+            pending[memm_shard_of(ptrs[i]) - g_memm.shards]++;
+        }
+    }
+}
+
+/// @brief frees of a batch accounted together, callsite statistics are flushed whenever the callsite changes
+typedef struct memm_free_tally
+{
+    uint32_t callsite;          // callsite of the current run
+    size_t count;               // blocks of the current run
+    size_t bytes;               // bytes of the current run
+    size_t total_count;         // every block of the batch, for the counters
+    size_t total_bytes;
+    uint64_t now;               // clock read once for the lifetimes of the whole batch
+} memm_free_tally_t;
+
+/// @brief flushes the current run of a tally to its callsite
+static void memm_tally_flush(memm_free_tally_t* tally)
+{
+    if (tally->count) {
+        memm_callsite_count_free(tally->callsite, tally->count, tally->bytes, 0);
+    }
+    tally->count = 0;
+    tally->bytes = 0;
+}
+
+/// @brief adds a freed block to a tally at the level it was allocated with
+static void memm_tally_add(memm_free_tally_t* tally, size_t size, uint32_t callsite, uint64_t timestamp, size_t level)
+{
+    tally->total_count++;
+    tally->total_bytes += size;
+    if (level < MEMM_LEVEL_CALLSITES) return;
+
+    if (tally->count && tally->callsite != callsite) {
+        memm_tally_flush(tally);
+    }
+    tally->callsite = callsite;
+    tally->count++;
+    tally->bytes += size;
+
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    if (level == MEMM_LEVEL_FULL && timestamp) {
+        memm_callsite_count_lifetime(memm_callsite_get(callsite), 1, timestamp, tally->now);
+    }
+    #else
+    (void)timestamp;
+    #endif
+}
+#endif
+
+/// @brief registers a batch of blocks of size bytes from one callsite, every shard lock is taken once and the statistics are updated once
+static void memm_register_batch(void** ptrs, size_t count, size_t size, uint32_t callsite)
+{
+    #ifdef MEMM_SAMPLING
+    // every block draws its own sample
+    for (size_t i = 0; i < count; i++) {
+        memm_register_allocation(ptrs[i], size, callsite);
+    }
+    #else
+    size_t level = memm_atomic_load(&g_memm_level);
+    size_t registered = 0;
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    uint64_t now = memm_clock_ticks();
+    #endif
+    size_t pending[MEMM_SHARD_COUNT];
+
+    #ifdef MEMM_INLINE_HEADERS
+    // a block with a header has to stay recognizable, so it is tracked at least at the counters level
+    if (level == MEMM_LEVEL_OFF) {
+        level = MEMM_LEVEL_COUNTERS;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        memm_allocation_t* alloc = memm_header_of(ptrs[i]);
+        alloc->size = size;
+        alloc->callsite = callsite;
+        #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+        alloc->timestamp = level == MEMM_LEVEL_FULL ? now : 0;
+        #endif
+        alloc->magic = MEMM_HEADER_MAGIC | (alloc->magic & MEMM_HEADER_PADDED) | (uint32_t)level;
+        alloc->session = g_memm_session;
+        alloc->prev = NULL;
+        alloc->next = NULL;
+    }
+
+    if (level == MEMM_LEVEL_FULL) {
+        memm_batch_shards(ptrs, count, pending);
+        for (size_t s = 0; s < MEMM_SHARD_COUNT; s++) {
+            if (!pending[s]) continue;
+
+            memm_shard_t* shard = &g_memm.shards[s];
+            memm_lock_acquire(&shard->lock);
+            for (size_t i = 0; pending[s] > 0; i++) {
+                if (memm_shard_of(ptrs[i]) == shard) {
+                    memm_live_insert(shard, memm_header_of(ptrs[i]));
+                    pending[s]--;
+                }
+            }
+            memm_lock_release(&shard->lock);
+        }
+    }
+    registered = count;
+    #else
+    if (level == MEMM_LEVEL_OFF) {
+        // the blocks go untracked, marking it once is enough
+        if (count) {
+            memm_passthrough(ptrs[0], size);
+        }
+        return;
+    }
+
+    // every block of the batch has the same size and callsite, so they all share the same light entry
+    memm_allocation_t* light = NULL;
+    if (level != MEMM_LEVEL_FULL && !memm_light_pack(size, callsite, level, &light)) {
+        light = NULL;
+    }
+
+    memm_batch_shards(ptrs, count, pending);
+    for (size_t s = 0; s < MEMM_SHARD_COUNT; s++) {
+        if (!pending[s]) continue;
+
+        memm_shard_t* shard = &g_memm.shards[s];
+        size_t inserted = 0;
+        memm_lock_acquire(&shard->lock);
+        if (!light && !shard->records.object_size) {
+            memm_slab_pool_init(&shard->records, sizeof(memm_allocation_t), MEMM_RECORD_SLAB_SIZE);
+        }
+
+        for (size_t i = 0; pending[s] > 0; i++) {
+            if (memm_shard_of(ptrs[i]) != shard) continue;
+            pending[s]--;
+
+            memm_allocation_t* entry = light;
+            if (!entry) {
+                entry = (memm_allocation_t*)memm_slab_pool_get(&shard->records);
+                if (entry) {
+                    entry->ptr = ptrs[i];
+                    entry->size = size;
+                    entry->callsite = callsite;
+                    entry->level = (uint32_t)level;
+                    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+                    entry->timestamp = now;
+                    #endif
+                }
+            }
+
+            if (entry && memm_index_insert(&shard->index, ptrs[i], entry)) {
+                inserted++;
+                continue;
+            }
+
+            if (entry && !memm_is_light(entry)) {
+                memm_slab_pool_put(&shard->records, entry);
+            }
+            #ifdef MEMM_ENABLE_LOGGING
+            fprintf(stderr, "MEMM-ERROR: Failed to register allocation for %p\n", ptrs[i]);
+            #endif
+            memm_passthrough(ptrs[i], size);
+        }
+        memm_atomic_store(&shard->tracked, shard->tracked + inserted);
+        memm_lock_release(&shard->lock);
+        registered += inserted;
+    }
+    #endif
+
+    if (registered) {
+        if (level >= MEMM_LEVEL_CALLSITES) {
+            memm_callsite_count_allocation(callsite, registered, registered * size);
+        }
+        memm_counters_count_allocation(size, registered, registered * size);
+    }
+    #endif
+}
+
+/// @brief unregisters and deallocates a batch of blocks, every shard lock is taken once and the statistics are updated once per run of callsite
+static void memm_free_batch_blocks(void** ptrs, size_t count)
+{
+    #ifdef MEMM_SAMPLING
+    for (size_t i = 0; i < count; i++) {
+        memm_free(ptrs[i], "memm_free_batch", 0);
+    }
+    #else
+    memm_free_tally_t tally = { 0 };
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    tally.now = memm_clock_ticks();
+    #endif
+    size_t pending[MEMM_SHARD_COUNT];
+    memm_batch_shards(ptrs, count, pending);
+
+    #ifdef MEMM_INLINE_HEADERS
+    // listed blocks leave the lists shard by shard, then every header is read and cleared without locking
+    for (size_t s = 0; s < MEMM_SHARD_COUNT; s++) {
+        if (!pending[s]) continue;
+
+        memm_shard_t* shard = &g_memm.shards[s];
+        memm_lock_acquire(&shard->lock);
+        for (size_t i = 0; pending[s] > 0; i++) {
+            if (!ptrs[i] || memm_shard_of(ptrs[i]) != shard) continue;
+            pending[s]--;
+
+            memm_allocation_t* header = memm_tracked_header(ptrs[i]);
+            if (header && memm_allocation_level(header) == MEMM_LEVEL_FULL) {
+                memm_live_remove(shard, header);
+            }
+        }
+        memm_lock_release(&shard->lock);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!ptrs[i]) continue;
+
+        memm_allocation_t* header = memm_tracked_header(ptrs[i]);
+        if (header) {
+            memm_tally_add(&tally, header->size, header->callsite, memm_allocation_timestamp(header), memm_allocation_level(header));
+            header->magic &= MEMM_HEADER_PADDED;
+            memm_block_free(ptrs[i]);
+            continue;
+        }
+
+        memm_free_untracked(ptrs[i], "memm_free_batch", 0);
+    }
+    #else
+    for (size_t s = 0; s < MEMM_SHARD_COUNT; s++) {
+        if (!pending[s]) continue;
+
+        memm_shard_t* shard = &g_memm.shards[s];
+        size_t removed = 0;
+        memm_lock_acquire(&shard->lock);
+        for (size_t i = 0; pending[s] > 0; i++) {
+            if (!ptrs[i] || memm_shard_of(ptrs[i]) != shard) continue;
+            pending[s]--;
+
+            memm_allocation_t* entry = memm_index_remove(&shard->index, ptrs[i]);
+            if (!entry) {
+                memm_atomic_add(&g_memm.untracked_frees, 1);
+                #ifdef MEMM_ENABLE_LOGGING
+                if (!memm_atomic_load(&g_memm.untracked_blocks)) {
+                    fprintf(stderr, "MEMM-WARN: free on an untracked memory %p (memm_free_batch)\n", ptrs[i]);
+                }
+                #endif
+                continue;
+            }
+
+            removed++;
+            if (memm_is_light(entry)) {
+                size_t size, level;
+                uint32_t callsite;
+                memm_light_unpack(entry, &size, &callsite, &level);
+                memm_tally_add(&tally, size, callsite, 0, level);
+            }
+
+            else {
+                memm_tally_add(&tally, entry->size, entry->callsite, memm_allocation_timestamp(entry), entry->level);
+                memm_slab_pool_put(&shard->records, entry);
+            }
+        }
+        memm_atomic_store(&shard->tracked, shard->tracked - removed);
+        memm_lock_release(&shard->lock);
+    }
+
+    // without headers tracked and untracked blocks are released the same way, outside the locks
+    for (size_t i = 0; i < count; i++) {
+        memm_block_free(ptrs[i]);
+    }
+    #endif
+
+    memm_tally_flush(&tally);
+    if (tally.total_count) {
+        memm_counters_count_free(tally.total_count, tally.total_bytes);
+    }
+    #endif
+}
+
+/// @brief header of an arena chunk, the arena blocks follow it
+typedef struct memm_arena_chunk
+{
+    struct memm_arena_chunk* next;
+    size_t capacity;            // bytes available after the header
+} memm_arena_chunk_t;
+
+/// @brief bytes taken by a chunk header, keeping the first block aligned
+#define MEMM_ARENA_CHUNK_HEADER ((sizeof(memm_arena_chunk_t) + MEMM_ARENA_ALIGNMENT - 1) & ~(size_t)(MEMM_ARENA_ALIGNMENT - 1))
+
+/// @brief a bump allocator, its chunks take no tracking record so they never show up as individual blocks
+struct memm_arena
+{
+    memm_arena_chunk_t* chunks;     // every chunk, the ones after current are reused after a reset
+    memm_arena_chunk_t* current;    // chunk blocks are bumped from
+    char* bump;                     // next free byte of the current chunk
+    char* end;                      // end of the current chunk
+    size_t chunk_size;              // bytes reserved per chunk, larger blocks get a chunk of their own
+    uint32_t callsite;              // where the arena was created, its chunks are accounted there
+    size_t level;                   // tracking level the arena was created with, MEMM_LEVEL_OFF once forgotten
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    uint64_t timestamp;             // memm_clock_ticks() when the arena was created
+    #endif
+    size_t chunk_count;             // statistics, only the owner writes them but reports read them concurrently
+    size_t reserved_bytes;
+    size_t used_bytes;
+    size_t object_count;
+    size_t peak_used_bytes;
+    size_t reset_count;
+    struct memm_arena* prev;        // list of tracked arenas
+    struct memm_arena* next;
+};
+
+/// @brief every arena not yet destroyed, arenas live outside g_memm so they survive the resets of memm_init
+typedef struct memm_arenas
+{
+    memm_lock_t lock;
+    memm_arena_t* head;
+} memm_arenas_t;
+
+/// @brief arena registry
+static memm_arenas_t g_memm_arenas = { MEMM_LOCK_INITIALIZER, NULL };
+
+/// @brief returns the first block of a chunk
+static char* memm_arena_chunk_data(memm_arena_chunk_t* chunk)
+{
+    return (char*)chunk + MEMM_ARENA_CHUNK_HEADER;
+}
+
+/// @brief makes the arena bump from chunk
+static void memm_arena_use(memm_arena_t* arena, memm_arena_chunk_t* chunk)
+{
+    arena->current = chunk;
+    arena->bump = memm_arena_chunk_data(chunk);
+    arena->end = arena->bump + chunk->capacity;
+}
+
+/// @brief reserves a chunk with room for at least size bytes right after the current one, accounting it at the arena level
+static bool memm_arena_grow(memm_arena_t* arena, size_t size)
+{
+    size_t capacity = size > arena->chunk_size ? size : arena->chunk_size;
+    if (capacity > SIZE_MAX - MEMM_ARENA_CHUNK_HEADER) return false;
+
+    memm_arena_chunk_t* chunk = (memm_arena_chunk_t*)memm_libc_malloc(MEMM_ARENA_CHUNK_HEADER + capacity);
+    if (!chunk) return false;
+
+    chunk->capacity = capacity;
+    if (arena->current) {
+        chunk->next = arena->current->next;
+        arena->current->next = chunk;
+    }
+
+    else {
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+    memm_arena_use(arena, chunk);
+
+    memm_atomic_store(&arena->chunk_count, arena->chunk_count + 1);
+    memm_atomic_store(&arena->reserved_bytes, arena->reserved_bytes + capacity);
+    if (arena->level >= MEMM_LEVEL_COUNTERS) {
+        memm_count_allocation(capacity, arena->callsite, arena->level);
+    }
+    return true;
+}
+
+/// @brief detaches every arena from the registry, they keep working but are no longer accounted nor reported
+static void memm_arenas_forget()
+{
+    memm_lock_acquire(&g_memm_arenas.lock);
+    memm_arena_t* arena = g_memm_arenas.head;
+    while (arena) {
+        memm_arena_t* next = arena->next;
+        arena->level = MEMM_LEVEL_OFF;
+        arena->prev = arena->next = NULL;
+        arena = next;
+    }
+    g_memm_arenas.head = NULL;
+    memm_lock_release(&g_memm_arenas.lock);
+}
+
+/// @brief a fixed-size object pool, its slabs take no tracking record so objects never show up as individual blocks
+struct memm_pool
+{
+    memm_lock_t lock;               // guards the slab pool, MEMM_THREAD_SAFE only
+    memm_slab_pool_t slabs;
+    size_t slab_bytes;              // bytes reserved per slab
+    uint32_t callsite;              // where the pool was created, its slabs are accounted there
+    size_t level;                   // tracking level the pool was created with, MEMM_LEVEL_OFF once forgotten
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    uint64_t timestamp;             // memm_clock_ticks() when the pool was created
+    #endif
+    size_t live_count;              // statistics, written under the pool lock but read by reports without it
+    size_t peak_count;
+    size_t capacity;
+    size_t slab_count;
+    size_t reserved_bytes;
+    struct memm_pool* prev;         // list of tracked pools
+    struct memm_pool* next;
+};
+
+/// @brief every pool not yet destroyed, pools live outside g_memm so they survive the resets of memm_init
+typedef struct memm_pools
+{
+    memm_lock_t lock;
+    memm_pool_t* head;
+} memm_pools_t;
+
+/// @brief pool registry
+static memm_pools_t g_memm_pools = { MEMM_LOCK_INITIALIZER, NULL };
+
+/// @brief detaches every pool from the registry, they keep working but are no longer accounted nor reported
+static void memm_pools_forget()
+{
+    memm_lock_acquire(&g_memm_pools.lock);
+    memm_pool_t* pool = g_memm_pools.head;
+    while (pool) {
+        memm_pool_t* next = pool->next;
+        pool->level = MEMM_LEVEL_OFF;
+        pool->prev = pool->next = NULL;
+        pool = next;
+    }
+    g_memm_pools.head = NULL;
+    memm_lock_release(&g_memm_pools.lock);
+}
+
+/// @brief accumulates report output into a fixed chunk, handing it to the write callback whenever it fills up
+typedef struct memm_writer
+{
+    memm_write_fn write;
+    void* user;
+    bool failed;                // the callback refused a chunk, the report stops early
+    size_t used;                // bytes waiting in chunk
+    char chunk[MEMM_REPORT_CHUNK_SIZE];
+} memm_writer_t;
+
+/// @brief a caller-supplied buffer reports are truncated into
+typedef struct memm_buffer_sink
+{
+    char* buffer;
+    size_t size;
+    size_t used;
+} memm_buffer_sink_t;
+
+/// @brief hands the pending chunk to the write callback
+static void memm_writer_flush(memm_writer_t* writer)
+{
+    if (writer->used > 0 && !writer->failed) {
+        writer->failed = !writer->write(writer->user, writer->chunk, writer->used);
+    }
+    writer->used = 0;
+}
+
+/// @brief formats a line into the chunk, flushing it first if the line doesn't fit, lines longer than a chunk are truncated
+static void memm_writer_printf(memm_writer_t* writer, const char* format, ...)
+{
+    if (writer->failed) return;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        size_t space = MEMM_REPORT_CHUNK_SIZE - writer->used;
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(writer->chunk + writer->used, space, format, args);
+        va_end(args);
+
+        if (written < 0) {
+            writer->failed = true;
+            return;
+        }
+
+        if ((size_t)written < space) {
+            writer->used += written;
+            return;
+        }
+
+        if (writer->used == 0) {
+            writer->used = MEMM_REPORT_CHUNK_SIZE - 1;
+            return;
+        }
+        memm_writer_flush(writer);
+    }
+}
+
+/// @brief copies report output into a caller-supplied buffer, refusing more once it is full
+static bool memm_buffer_write(void* user, const char* data, size_t size)
+{
+    memm_buffer_sink_t* sink = (memm_buffer_sink_t*)user;
+    size_t space = sink->size - 1 - sink->used;
+    size_t copied = size < space ? size : space;
+
+    memcpy(sink->buffer + sink->used, data, copied);
+    sink->used += copied;
+    sink->buffer[sink->used] = '\0';
+    return copied == size;
+}
+
+/// @brief runs a streaming report into a caller-supplied buffer, returning how many characters were written
+static int memm_report_to_buffer(char* buffer, size_t buffer_size, bool (*report)(memm_writer_t*, size_t, memm_sort_key_t), size_t n, memm_sort_key_t sort_key)
+{
+    if (!buffer || buffer_size == 0) {
+        return -1;
+    }
+
+    memm_buffer_sink_t sink = { buffer, buffer_size, 0 };
+    buffer[0] = '\0';
+
+    memm_writer_t* writer = (memm_writer_t*)memm_libc_malloc(sizeof(memm_writer_t));
+    if (!writer) {
+        return -1;
+    }
+
+    writer->write = memm_buffer_write;
+    writer->user = &sink;
+    writer->failed = false;
+    writer->used = 0;
+    report(writer, n, sort_key);
+    memm_libc_free(writer);
+    return (int)sink.used;
+}
+
+/// @brief runs a streaming report into a write callback, returning false if the callback stopped it
+static bool memm_report_to_callback(memm_write_fn write, void* user, bool (*report)(memm_writer_t*, size_t, memm_sort_key_t), size_t n, memm_sort_key_t sort_key)
+{
+    if (!write) {
+        return false;
+    }
+
+    memm_writer_t writer;
+    writer.write = write;
+    writer.user = user;
+    writer.failed = false;
+    writer.used = 0;
+    return report(&writer, n, sort_key);
+}
+
+/// @brief unit of the global byte totals, with MEMM_SAMPLING unsampled frees only know the usable size so every block is counted by it
+#ifdef MEMM_SAMPLING
+    #define MEMM_COUNTED_BYTES "usable bytes"
+#else
+    #define MEMM_COUNTED_BYTES "bytes"
+#endif
+
+/// @brief streams the statistics report
+static bool memm_report_stats(memm_writer_t* writer, size_t n, memm_sort_key_t sort_key)
+{
+    (void)n;
+    (void)sort_key;
+
+    memm_counters_t sum;
+    memm_counters_sum(&sum);
+    size_t current_usage = sum.total_allocated > sum.total_freed ? sum.total_allocated - sum.total_freed : 0;
+    memm_atomic_max(&g_memm.peak_memory, current_usage);
+
+    memm_writer_printf(writer,
+        "=== MEMORY STATISTICS ===\n"
+        "Total allocated:      %zu " MEMM_COUNTED_BYTES "\n"
+        "Total freed:          %zu " MEMM_COUNTED_BYTES "\n"
+        "Current usage:        %zu " MEMM_COUNTED_BYTES "\n"
+        "Peak memory usage:    %zu " MEMM_COUNTED_BYTES "\n"
+        "Allocation calls:     %zu\n"
+        "Free calls:           %zu\n"
+        "Potential leaks:      %zu objects\n"
+        "Size mismatches:      %zu sized frees\n"
+        "Untracked frees:      %zu\n",
+        sum.total_allocated,
+        sum.total_freed,
+        current_usage,
+        memm_atomic_load(&g_memm.peak_memory),
+        sum.allocation_count,
+        sum.free_count,
+        sum.allocation_count - sum.free_count,
+        memm_atomic_load(&g_memm.size_mismatches),
+        memm_atomic_load(&g_memm.untracked_frees)
+    );
+
+    size_t arena_count = 0, chunk_count = 0, reserved_bytes = 0, used_bytes = 0, object_count = 0;
+    memm_lock_acquire(&g_memm_arenas.lock);
+    for (memm_arena_t* arena = g_memm_arenas.head; arena; arena = arena->next) {
+        arena_count++;
+        chunk_count += memm_atomic_load(&arena->chunk_count);
+        reserved_bytes += memm_atomic_load(&arena->reserved_bytes);
+        used_bytes += memm_atomic_load(&arena->used_bytes);
+        object_count += memm_atomic_load(&arena->object_count);
+    }
+    memm_lock_release(&g_memm_arenas.lock);
+    memm_writer_printf(writer, "Arenas:               %zu (%zu bytes in %zu chunks, %zu bytes used by %zu objects)\n", arena_count, reserved_bytes, chunk_count, used_bytes, object_count);
+
+    size_t pool_count = 0;
+    memm_lock_acquire(&g_memm_pools.lock);
+    for (memm_pool_t* pool = g_memm_pools.head; pool; pool = pool->next) {
+        pool_count++;
+    }
+    memm_writer_printf(writer, "Pools:                %zu\n", pool_count);
+    for (memm_pool_t* pool = g_memm_pools.head; pool && !writer->failed; pool = pool->next) {
+        memm_callsite_t* site = memm_callsite_get(pool->callsite);
+        memm_writer_printf(writer, "  pool %p: %zu byte objects, %zu live, %zu peak, %zu capacity (%s:%d)\n", (void*)pool, pool->slabs.object_size, memm_atomic_load(&pool->live_count), memm_atomic_load(&pool->peak_count), memm_atomic_load(&pool->capacity), site->file, site->line);
+    }
+    memm_lock_release(&g_memm_pools.lock);
+
+    #ifdef MEMM_INLINE_HEADERS
+    memm_writer_printf(writer, "Tracking mode:        inline headers (%zu bytes each)\n", MEMM_HEADER_SIZE);
+    #else
+    memm_writer_printf(writer, "Hash table size:      %zu slots\n", memm_index_total_capacity());
+    memm_writer_printf(writer, "Hash function:        %s\n", memm_hash_name());
+    #endif
+    memm_writer_printf(writer, "Lock shards:          %d\n", MEMM_SHARD_COUNT);
+    #ifdef MEMM_SMALL_ALLOCATOR
+    size_t small_pages = memm_atomic_load(&g_memm_small.pages_used);
+    memm_writer_printf(writer, "Small object heap:    %zu pages of %d bytes, blocks up to %d bytes\n", small_pages < MEMM_SMALL_PAGES ? small_pages : (size_t)MEMM_SMALL_PAGES, MEMM_SMALL_PAGE_SIZE, MEMM_SMALL_MAX_SIZE);
+
+    size_t cache_threads = 0, cached_bytes = 0, cache_flushes = 0;
+    memm_lock_acquire(&g_memm_small_lock);
+    for (memm_small_thread_t* thread = g_memm_small.threads; thread; thread = thread->next) {
+        cache_threads += thread->idle ? 0 : 1;
+        cache_flushes += memm_atomic_load(&thread->flushes);
+        for (size_t i = 0; i < MEMM_SMALL_CLASSES; i++) {
+            cached_bytes += memm_atomic_load(&thread->caches[i].count) * memm_small_class_size(i);
+        }
+    }
+    size_t reclaimed = g_memm_small.reclaimed;
+    memm_lock_release(&g_memm_small_lock);
+    memm_writer_printf(writer, "Thread caches:        %zu threads, %zu bytes cached, %zu batches flushed, %zu reclaimed from exited threads\n", cache_threads, cached_bytes, cache_flushes, reclaimed);
+    #endif
+    #ifdef MEMM_MMAP_THRESHOLD
+    memm_writer_printf(writer, "Mapped blocks:        %zu (%zu bytes mapped, peak %zu bytes, %zu resized by remapping), from %zu bytes up\n", memm_atomic_load(&g_memm_mappings.count), memm_atomic_load(&g_memm_mappings.mapped_bytes), memm_atomic_load(&g_memm_mappings.peak_bytes), memm_atomic_load(&g_memm_mappings.remaps), (size_t)MEMM_MMAP_THRESHOLD);
+    #endif
+    memm_writer_printf(writer, "Tracking level:       %s\n", memm_level_name(memm_atomic_load(&g_memm_level)));
+    #ifdef MEMM_SAMPLING
+    memm_writer_printf(writer, "Sampling interval:    %zu bytes\n", (size_t)MEMM_SAMPLE_INTERVAL);
+    #endif
+
+    #if MEMM_CLOCK_SOURCE == MEMM_CLOCK_CYCLES
+    double ns_per_tick = memm_clock_ns_per_tick();
+    memm_writer_printf(writer, "Clock source:         %s (%.1f MHz)\n", memm_clock_name(), ns_per_tick > 0.0 ? 1e3 / ns_per_tick : 0.0);
+    #else
+    memm_writer_printf(writer, "Clock source:         %s\n", memm_clock_name());
+    #endif
+
+    size_t* size_classes = (size_t*)memm_libc_malloc(sizeof(size_t) * MEMM_SIZE_BUCKETS);
+    if (size_classes) {
+        memm_size_classes_sum(size_classes);
+        memm_writer_printf(writer, "Size histogram:\n");
+        for (size_t i = 0; i < MEMM_SIZE_BUCKETS; i++) {
+            if (size_classes[i] == 0) continue;
+
+            if (i + 1 < MEMM_SIZE_BUCKETS) {
+                memm_writer_printf(writer, "  %12llu .. %-12llu bytes: %zu\n", (unsigned long long)memm_size_class_lower_bound(i), (unsigned long long)memm_size_class_lower_bound(i + 1) - 1, size_classes[i]);
+            }
+
+            else {
+                memm_writer_printf(writer, "  %12llu or more     bytes: %zu\n", (unsigned long long)memm_size_class_lower_bound(i), size_classes[i]);
+            }
+        }
+        memm_libc_free(size_classes);
+    }
+
+    memm_writer_flush(writer);
+    return !writer->failed;
+}
+
+/// @brief streams every arena tracked at the full level as a single entry, adding its chunks to the report totals
+static void memm_report_arenas(memm_writer_t* writer, bool leaks, size_t* total_count, size_t* total_bytes)
+{
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    double ns_per_tick = memm_clock_ns_per_tick();
+    uint64_t now = memm_clock_ticks();
+    #endif
+
+    memm_lock_acquire(&g_memm_arenas.lock);
+    for (memm_arena_t* arena = g_memm_arenas.head; arena && !writer->failed; arena = arena->next) {
+        if (arena->level != MEMM_LEVEL_FULL) continue;
+
+        size_t chunks = memm_atomic_load(&arena->chunk_count);
+        size_t reserved = memm_atomic_load(&arena->reserved_bytes);
+        memm_callsite_t* site = memm_callsite_get(arena->callsite);
+        if (leaks) {
+            memm_writer_printf(writer, "  LEAK: %6zu bytes at arena %p, %zu chunks (%s:%d)\n", reserved, (void*)arena, chunks, site->file, site->line);
+        }
+
+        else {
+            #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+            double age_ms = now > arena->timestamp ? (double)(now - arena->timestamp) * ns_per_tick / 1e6 : 0.0;
+            memm_writer_printf(writer, "  arena %p: %6zu bytes in %zu chunks, %zu used by %zu objects @ %s:%d, %.3f ms old\n", (void*)arena, reserved, chunks, memm_atomic_load(&arena->used_bytes), memm_atomic_load(&arena->object_count), site->file, site->line, age_ms);
+            #else
+            memm_writer_printf(writer, "  arena %p: %6zu bytes in %zu chunks, %zu used by %zu objects @ %s:%d\n", (void*)arena, reserved, chunks, memm_atomic_load(&arena->used_bytes), memm_atomic_load(&arena->object_count), site->file, site->line);
+            #endif
+        }
+        *total_count += chunks;
+        *total_bytes += reserved;
+    }
+    memm_lock_release(&g_memm_arenas.lock);
+}
+
+/// @brief streams every pool tracked at the full level as a single entry, adding its slabs to the report totals
+static void memm_report_pools(memm_writer_t* writer, bool leaks, size_t* total_count, size_t* total_bytes)
+{
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    double ns_per_tick = memm_clock_ns_per_tick();
+    uint64_t now = memm_clock_ticks();
+    #endif
+
+    memm_lock_acquire(&g_memm_pools.lock);
+    for (memm_pool_t* pool = g_memm_pools.head; pool && !writer->failed; pool = pool->next) {
+        if (pool->level != MEMM_LEVEL_FULL) continue;
+
+        size_t slabs = memm_atomic_load(&pool->slab_count);
+        size_t reserved = memm_atomic_load(&pool->reserved_bytes);
+        size_t live = memm_atomic_load(&pool->live_count);
+        memm_callsite_t* site = memm_callsite_get(pool->callsite);
+        if (leaks) {
+            memm_writer_printf(writer, "  LEAK: %6zu bytes at pool %p, %zu live objects of %zu bytes (%s:%d)\n", reserved, (void*)pool, live, pool->slabs.object_size, site->file, site->line);
+        }
+
+        else {
+            #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+            double age_ms = now > pool->timestamp ? (double)(now - pool->timestamp) * ns_per_tick / 1e6 : 0.0;
+            memm_writer_printf(writer, "  pool %p: %6zu bytes in %zu slabs, %zu live objects of %zu bytes @ %s:%d, %.3f ms old\n", (void*)pool, reserved, slabs, live, pool->slabs.object_size, site->file, site->line, age_ms);
+            #else
+            memm_writer_printf(writer, "  pool %p: %6zu bytes in %zu slabs, %zu live objects of %zu bytes @ %s:%d\n", (void*)pool, reserved, slabs, live, pool->slabs.object_size, site->file, site->line);
+            #endif
+        }
+        *total_count += slabs;
+        *total_bytes += reserved;
+    }
+    memm_lock_release(&g_memm_pools.lock);
+}
+
+/// @brief streams every live allocation, either as the allocations or the leak report
+static bool memm_report_live(memm_writer_t* writer, bool leaks)
+{
+    memm_writer_printf(writer, leaks ? "=== MEMORY LEAK REPORT ===\n" : "=== CURRENT ALLOCATIONS ===\n");
+    
+    size_t total_count = 0;
+    size_t total_bytes = 0;
+    #ifdef MEMM_SAMPLING
+    size_t samples = 0;
+    #endif
+    
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    double ns_per_tick = memm_clock_ns_per_tick();
+    uint64_t now = memm_clock_ticks();
+    #endif
+
+    memm_cursor_t iterator = { 0 };
+    memm_allocation_t* current = NULL;
+    while (!writer->failed && (current = memm_cursor_next(&iterator))) {
+        #ifndef MEMM_INLINE_HEADERS
+        // blocks that only needed a record because they didn't fit a light entry
+        if (current->level != MEMM_LEVEL_FULL) continue;
+        #endif
+
+        memm_callsite_t* site = memm_callsite_get(current->callsite);
+        if (leaks) {
+            memm_writer_printf(writer, "  LEAK: %6zu bytes at %p (%s:%d)\n", current->size, memm_allocation_ptr(current), site->file, site->line);
+        }
+
+        else {
+            #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+            // timestamps taken by other threads may be a few ticks ahead of now
+            double age_ms = now > current->timestamp ? (double)(now - current->timestamp) * ns_per_tick / 1e6 : 0.0;
+            memm_writer_printf(writer, "  %p: %6zu bytes @ %s:%d, %.3f ms old\n", memm_allocation_ptr(current), current->size, site->file, site->line, age_ms);
+            #else
+            memm_writer_printf(writer, "  %p: %6zu bytes @ %s:%d\n", memm_allocation_ptr(current), current->size, site->file, site->line);
+            #endif
+        }
+        #ifdef MEMM_SAMPLING
+        size_t count, bytes;
+        memm_sample_weight(current->size, &count, &bytes);
+        total_count += count;
+        total_bytes += bytes;
+        samples++;
+        #else
+        total_count++;
+        total_bytes += current->size;
+        #endif
+    }
+    memm_cursor_stop(&iterator);
+    memm_report_arenas(writer, leaks, &total_count, &total_bytes);
+    memm_report_pools(writer, leaks, &total_count, &total_bytes);
+    
+    #ifdef MEMM_SAMPLING
+    // only sampled blocks are listed, the exact live count comes from the counters
+    memm_counters_t sum;
+    memm_counters_sum(&sum);
+    size_t alive = sum.allocation_count - sum.free_count;
+    if (alive == 0) {
+        memm_writer_printf(writer, leaks ? "  No memory leaks detected!\n" : "  No active allocations\n");
+    }
+
+    else {
+        memm_writer_printf(writer, leaks ? "  TOTAL LEAKS: ~%zu allocations, ~%zu bytes estimated from %zu samples (%zu blocks alive)\n" : "  Total: ~%zu allocations, ~%zu bytes estimated from %zu samples (%zu blocks alive)\n", total_count, total_bytes, samples, alive);
+    }
+    #else
+    if (total_count == 0) {
+        memm_writer_printf(writer, leaks ? "  No memory leaks detected!\n" : "  No active allocations\n");
+    }
+
+    else {
+        memm_writer_printf(writer, leaks ? "  TOTAL LEAKS: %zu allocations, %zu bytes\n" : "  Total: %zu allocations, %zu bytes\n", total_count, total_bytes);
+    }
+    #endif
+
+    memm_writer_flush(writer);
+    return !writer->failed;
+}
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////// Internal Implementation
+/// @brief streams the allocations report
+static bool memm_report_allocations(memm_writer_t* writer, size_t n, memm_sort_key_t sort_key)
+{
+    (void)n;
+    (void)sort_key;
+    return memm_report_live(writer, false);
+}
 
-/// @brief holds an alocation information
-typedef struct memm_allocation
+/// @brief streams the leak report
+static bool memm_report_leaks(memm_writer_t* writer, size_t n, memm_sort_key_t sort_key)
 {
-    void* ptr;
-    size_t size;
-    const char* file;
-    int line;
-    time_t timestamp;
-    struct memm_allocation* next;
-} memm_allocation_t;
+    (void)n;
+    (void)sort_key;
+    return memm_report_live(writer, true);
+}
 
-/// @brief holds the memm state, wich keeps tracks of all memory allocated stuff
-typedef struct memm
+/// @brief streams the n callsites with highest sort_key
+static bool memm_report_top_callsites(memm_writer_t* writer, size_t n, memm_sort_key_t sort_key)
+{
+    static const char* sort_names[] = { "LIVE BYTES", "LIVE COUNT", "TOTAL BYTES", "CALL COUNT", "PEAK BYTES", "FREED COUNT" };
+    if ((unsigned int)sort_key >= sizeof(sort_names) / sizeof(sort_names[0])) {
+        sort_key = MEMM_SORT_LIVE_BYTES;
+    }
+
+    memm_writer_printf(writer, "=== TOP CALLSITES BY %s ===\n", sort_names[sort_key]);
+
+    uint32_t count = memm_callsite_count();
+    if (n > count) {
+        n = count;
+    }
+
+    memm_top_entry_t* heap = n ? (memm_top_entry_t*)memm_libc_malloc(n * sizeof(memm_top_entry_t)) : NULL;
+    size_t heap_size = heap ? memm_callsite_select(heap, n, sort_key) : 0;
+    for (size_t i = 0; i < heap_size && !writer->failed; i++) {
+        memm_callsite_t* site = memm_callsite_get(heap[i].id);
+        memm_writer_printf(writer, "  %8zu live bytes (%zu blocks), %10zu total bytes (%zu calls), %8zu peak bytes @ %s:%d\n",
+            memm_atomic_load(&site->live_bytes), memm_atomic_load(&site->live_count), memm_atomic_load(&site->total_bytes),
+            memm_atomic_load(&site->call_count), memm_atomic_load(&site->peak_bytes), site->file, site->line);
+    }
+    memm_libc_free(heap);
+
+    if (heap_size == 0) {
+        memm_writer_printf(writer, "  No callsites recorded\n");
+    }
+
+    memm_writer_flush(writer);
+    return !writer->failed;
+}
+
+#if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+/// @brief formats a duration with a unit that keeps it short
+static void memm_format_duration(char* buffer, size_t buffer_size, double ns)
+{
+    if (ns < 1e3) {
+        snprintf(buffer, buffer_size, "%.0f ns", ns);
+    }
+
+    else if (ns < 1e6) {
+        snprintf(buffer, buffer_size, "%.1f us", ns / 1e3);
+    }
+
+    else if (ns < 1e9) {
+        snprintf(buffer, buffer_size, "%.1f ms", ns / 1e6);
+    }
+
+    else {
+        snprintf(buffer, buffer_size, "%.1f s", ns / 1e9);
+    }
+}
+
+/// @brief returns the exclusive upper bound of the bucket holding the given fraction of lifetimes
+static double memm_lifetime_percentile(const memm_lifetime_stats_t* stats, double fraction)
+{
+    size_t target = (size_t)((double)stats->freed_count * fraction);
+    size_t seen = 0;
+    for (size_t i = 0; i < MEMM_LIFETIME_BUCKETS; i++) {
+        seen += stats->counts[i];
+        if (seen > target) {
+            return stats->limits_ns[i];
+        }
+    }
+    return stats->limits_ns[MEMM_LIFETIME_BUCKETS - 1];
+}
+
+/// @brief snapshots the lifetime histogram of a callsite, converting the tick buckets to nanoseconds
+static void memm_lifetime_snapshot(memm_callsite_t* site, double ns_per_tick, memm_lifetime_stats_t* stats)
+{
+    stats->file = site->file;
+    stats->line = site->line;
+    stats->freed_count = 0;
+    for (size_t i = 0; i < MEMM_LIFETIME_BUCKETS; i++) {
+        // bucket 0 holds lifetimes of 0 ticks, bucket i those in [2^(i-1), 2^i) ticks
+        stats->counts[i] = memm_atomic_load(&site->lifetimes[i]);
+        stats->limits_ns[i] = (double)((uint64_t)1 << i) * ns_per_tick;
+        stats->freed_count += stats->counts[i];
+    }
+}
+#endif
+
+/// @brief streams the lifetime percentiles and histograms of the n callsites that freed the most blocks
+static bool memm_report_lifetimes(memm_writer_t* writer, size_t n, memm_sort_key_t sort_key)
+{
+    (void)sort_key;
+
+    memm_writer_printf(writer, "=== ALLOCATION LIFETIMES ===\n");
+
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    uint32_t count = memm_callsite_count();
+    if (n > count) {
+        n = count;
+    }
+
+    memm_top_entry_t* heap = n ? (memm_top_entry_t*)memm_libc_malloc(n * sizeof(memm_top_entry_t)) : NULL;
+    memm_lifetime_stats_t* stats = heap ? (memm_lifetime_stats_t*)memm_libc_malloc(sizeof(memm_lifetime_stats_t)) : NULL;
+    size_t heap_size = stats ? memm_callsite_select(heap, n, MEMM_SORT_FREED_COUNT) : 0;
+    double ns_per_tick = memm_clock_ns_per_tick();
+    size_t reported = 0;
+
+    for (size_t i = 0; i < heap_size && heap[i].key > 0 && !writer->failed; i++) {
+        memm_lifetime_snapshot(memm_callsite_get(heap[i].id), ns_per_tick, stats);
+        if (stats->freed_count == 0) continue;
+
+        char p50[16], p90[16], p99[16];
+        memm_format_duration(p50, sizeof(p50), memm_lifetime_percentile(stats, 0.50));
+        memm_format_duration(p90, sizeof(p90), memm_lifetime_percentile(stats, 0.90));
+        memm_format_duration(p99, sizeof(p99), memm_lifetime_percentile(stats, 0.99));
+        memm_writer_printf(writer, "  %8zu freed, p50 < %s, p90 < %s, p99 < %s @ %s:%d\n", stats->freed_count, p50, p90, p99, stats->file, stats->line);
+
+        memm_writer_printf(writer, "   ");
+        for (size_t bucket = 0; bucket < MEMM_LIFETIME_BUCKETS; bucket++) {
+            if (stats->counts[bucket] == 0) continue;
+
+            char limit[16];
+            memm_format_duration(limit, sizeof(limit), stats->limits_ns[bucket]);
+            memm_writer_printf(writer, bucket + 1 < MEMM_LIFETIME_BUCKETS ? " <%s: %zu" : " longer: %zu", limit, stats->counts[bucket]);
+        }
+        memm_writer_printf(writer, "\n");
+        reported++;
+    }
+    memm_libc_free(stats);
+    memm_libc_free(heap);
+
+    if (reported == 0) {
+        memm_writer_printf(writer, "  No freed allocations recorded\n");
+    }
+    #else
+    (void)n;
+    memm_writer_printf(writer, "  Disabled, MEMM_CLOCK_SOURCE is MEMM_CLOCK_NONE\n");
+    #endif
+
+    memm_writer_flush(writer);
+    return !writer->failed;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// External Implementations
+
+MEMM_API void memm_init()
+{
+    // blocks allocated before the first memm_init, like those of c++ static constructors with MEMM_CXX_OPERATORS, stay tracked
+    memm_counters_t sum;
+    memm_counters_sum(&sum);
+    if (g_memm_initialized || sum.allocation_count == 0) {
+        #ifdef MEMM_INLINE_HEADERS
+        // the live lists are reset, so blocks still holding headers from the previous session must not reach them
+        if (g_memm_initialized) {
+            g_memm_session++;
+        }
+        #endif
+        memset(&g_memm, 0, sizeof(g_memm));
+        memm_counters_reset();
+        memm_callsite_reset();
+        memm_arenas_forget();
+        memm_pools_forget();
+        for (size_t i = 0; i < MEMM_SHARD_COUNT; i++) {
+            memm_lock_init(&g_memm.shards[i].lock);
+            #ifndef MEMM_INLINE_HEADERS
+            memm_slab_pool_init(&g_memm.shards[i].records, sizeof(memm_allocation_t), MEMM_RECORD_SLAB_SIZE);
+            #endif
+        }
+    }
+    g_memm_initialized = true;
+
+    #ifdef MEMM_CLOCK_CALIBRATED
+    g_memm.clock_anchor_ns = memm_clock_reference_ns();
+    g_memm.clock_anchor_ticks = memm_clock_ticks();
+    #endif
+
+    #ifdef MEMM_INLINE_HEADERS
+    #ifdef MEMM_ENABLE_LOGGING
+    printf("Memory manager initialized with inline headers\n");
+    #endif
+    #else
+    #ifdef MEMM_ENABLE_LOGGING
+    printf("Memory manager initialized with %d initial index slots\n", MEMM_HASH_TABLE_SIZE);
+    #endif
+    #endif
+}
+
+MEMM_API void memm_shutdown()
+{
+    // cleanup tracking structures, records live in slabs so no per-allocation walk is needed
+    for (size_t i = 0; i < MEMM_SHARD_COUNT; i++) {
+        memm_shard_t* shard = &g_memm.shards[i];
+        memm_lock_acquire(&shard->lock);
+        #ifdef MEMM_INLINE_HEADERS
+        shard->live = NULL;
+        #else
+        memm_slab_pool_release(&shard->records);
+        memm_index_release(&shard->index);
+        #endif
+        memm_lock_release(&shard->lock);
+    }
+
+    // blocks and arenas still alive are forgotten, so their frees are expected to be unknown
+    memm_arenas_forget();
+    memm_pools_forget();
+    memm_atomic_store(&g_memm.untracked_blocks, 1);
+    #ifdef MEMM_ENABLE_LOGGING
+    printf("Memory manager shutdown complete\n");
+    #endif
+}
+
+MEMM_API uint32_t memm_intern_callsite(const char* file, int line)
+{
+    if (!file) return 0;
+
+    memm_callsite_cache_t* cached = &t_memm_callsite_cache[(((size_t)file >> 3) ^ ((size_t)(unsigned int)line * 2654435761u)) & (MEMM_CALLSITE_CACHE_SIZE - 1)];
+    if (cached->file == file && cached->line == line) {
+        return cached->id;
+    }
+
+    memm_lock_acquire(&g_memm_callsites.lock);
+    uint32_t id = memm_callsite_intern_locked(file, line);
+    memm_lock_release(&g_memm_callsites.lock);
+
+    if (id) {
+        cached->file = file;
+        cached->line = line;
+        cached->id = id;
+    }
+    return id;
+}
+
+MEMM_API bool memm_get_callsite(uint32_t callsite, const char** file, int* line)
+{
+    memm_callsite_t* resolved = memm_callsite_get(callsite);
+    if (file) *file = resolved->file;
+    if (line) *line = resolved->line;
+    return resolved != &g_memm_unknown_callsite;
+}
+
+MEMM_API bool memm_get_callsite_stats(uint32_t callsite, memm_callsite_stats_t* stats)
+{
+    if (!stats) return false;
+
+    memm_callsite_t* site = memm_callsite_get(callsite);
+    stats->callsite = site == &g_memm_unknown_callsite ? 0 : callsite;
+    stats->file = site->file;
+    stats->line = site->line;
+    stats->live_count = memm_atomic_load(&site->live_count);
+    stats->live_bytes = memm_atomic_load(&site->live_bytes);
+    stats->total_bytes = memm_atomic_load(&site->total_bytes);
+    stats->call_count = memm_atomic_load(&site->call_count);
+    stats->peak_bytes = memm_atomic_load(&site->peak_bytes);
+    return site != &g_memm_unknown_callsite || callsite == 0;
+}
+
+MEMM_API bool memm_get_lifetime_stats(uint32_t callsite, memm_lifetime_stats_t* stats)
+{
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    if (!stats) return false;
+
+    memm_callsite_t* site = memm_callsite_get(callsite);
+    stats->callsite = site == &g_memm_unknown_callsite ? 0 : callsite;
+    memm_lifetime_snapshot(site, memm_clock_ns_per_tick(), stats);
+    return site != &g_memm_unknown_callsite || callsite == 0;
+    #else
+    (void)callsite;
+    (void)stats;
+    return false;
+    #endif
+}
+
+MEMM_API void memm_set_level(memm_level_t level)
+{
+    if ((size_t)level > MEMM_LEVEL_FULL) {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: Invalid tracking level %d\n", (int)level);
+        #endif
+        return;
+    }
+    memm_atomic_store(&g_memm_level, (size_t)level);
+}
+
+MEMM_API memm_level_t memm_get_level()
+{
+    return (memm_level_t)memm_atomic_load(&g_memm_level);
+}
+
+MEMM_API void* memm_malloc(size_t size, const char* file, int line)
+{
+    return memm_malloc_at(size, memm_intern_callsite(file, line));
+}
+
+MEMM_API void* memm_calloc(size_t num, size_t size, const char *file, int line)
+{
+    return memm_calloc_at(num, size, memm_intern_callsite(file, line));
+}
+
+MEMM_API void* memm_realloc(void *ptr, size_t size, const char *file, int line)
+{
+    return memm_realloc_at(ptr, size, memm_intern_callsite(file, line));
+}
+
+MEMM_API void* memm_aligned_alloc(size_t alignment, size_t size, const char* file, int line)
+{
+    return memm_aligned_alloc_at(alignment, size, memm_intern_callsite(file, line));
+}
+
+MEMM_API void* memm_memalign(size_t alignment, size_t size, const char* file, int line)
+{
+    return memm_memalign_at(alignment, size, memm_intern_callsite(file, line));
+}
+
+MEMM_API int memm_posix_memalign(void** out_ptr, size_t alignment, size_t size, const char* file, int line)
+{
+    return memm_posix_memalign_at(out_ptr, alignment, size, memm_intern_callsite(file, line));
+}
+
+MEMM_API void* memm_valloc(size_t size, const char* file, int line)
+{
+    return memm_valloc_at(size, memm_intern_callsite(file, line));
+}
+
+MEMM_API void* memm_malloc_at(size_t size, uint32_t callsite)
+{
+    #ifndef MEMM_INLINE_HEADERS
+    if (memm_atomic_load(&g_memm_level) == MEMM_LEVEL_OFF) {
+        return memm_passthrough(memm_system_malloc(size), size);
+    }
+    #endif
+
+    void* ptr = memm_block_malloc(size);
+    if (ptr) {
+        memm_register_allocation(ptr, size, callsite);
+    } 
+
+    else {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: malloc failed for %zu bytes (%s:%d)\n", size, memm_callsite_get(callsite)->file, memm_callsite_get(callsite)->line);
+        #endif
+    }
+    return ptr;
+}
+
+MEMM_API void* memm_calloc_at(size_t num, size_t size, uint32_t callsite)
+{
+    #ifndef MEMM_INLINE_HEADERS
+    if (memm_atomic_load(&g_memm_level) == MEMM_LEVEL_OFF) {
+        return memm_passthrough(memm_system_calloc(num, size), num * size);
+    }
+    #endif
+
+    void* ptr = memm_block_calloc(num, size);
+    if (ptr) {
+        memm_register_allocation(ptr, num * size, callsite);
+    } 
+
+    else {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: calloc failed for %zu elements of %zu bytes (%s:%d)\n", num, size, memm_callsite_get(callsite)->file, memm_callsite_get(callsite)->line);
+        #endif
+    }
+    return ptr;
+}
+
+MEMM_API void* memm_aligned_alloc_at(size_t alignment, size_t size, uint32_t callsite)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: aligned allocation with an alignment of %zu, not a power of 2 (%s:%d)\n", alignment, memm_callsite_get(callsite)->file, memm_callsite_get(callsite)->line);
+        #endif
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // malloc blocks are already aligned that much
+    if (alignment <= MEMM_MALLOC_ALIGNMENT) {
+        return memm_malloc_at(size, callsite);
+    }
+
+    #ifndef MEMM_INLINE_HEADERS
+    if (memm_atomic_load(&g_memm_level) == MEMM_LEVEL_OFF) {
+        return memm_passthrough(memm_system_aligned_alloc(alignment, size), size);
+    }
+    #endif
+
+    void* ptr = memm_block_aligned_alloc(alignment, size);
+    if (ptr) {
+        memm_register_allocation(ptr, size, callsite);
+    }
+
+    else {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: aligned allocation failed for %zu bytes aligned to %zu (%s:%d)\n", size, alignment, memm_callsite_get(callsite)->file, memm_callsite_get(callsite)->line);
+        #endif
+    }
+    return ptr;
+}
+
+MEMM_API void* memm_memalign_at(size_t alignment, size_t size, uint32_t callsite)
+{
+    // like glibc, an alignment that isn't a power of 2 is rounded up to the next one instead of rejected
+    size_t rounded = 1;
+    while (rounded < alignment) {
+        if (rounded > (size_t)-1 / 2) {
+            errno = EINVAL;
+            return NULL;
+        }
+        rounded *= 2;
+    }
+    return memm_aligned_alloc_at(rounded, size, callsite);
+}
+
+MEMM_API int memm_posix_memalign_at(void** out_ptr, size_t alignment, size_t size, uint32_t callsite)
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || alignment % sizeof(void*) != 0) return EINVAL;
+
+    void* ptr = memm_aligned_alloc_at(alignment, size, callsite);
+    if (!ptr) return ENOMEM;
+
+    *out_ptr = ptr;
+    return 0;
+}
+
+MEMM_API void* memm_valloc_at(size_t size, uint32_t callsite)
+{
+    #if defined(_WIN32) || defined(_WIN64)
+    size_t page_size = 4096;
+    #else
+    long queried = sysconf(_SC_PAGESIZE);
+    size_t page_size = queried > 0 ? (size_t)queried : 4096;
+    #endif
+    return memm_aligned_alloc_at(page_size, size, callsite);
+}
+
+MEMM_API void* memm_realloc_at(void *ptr, size_t size, uint32_t callsite)
+{
+    memm_callsite_t* site = memm_callsite_get(callsite);
+
+    // a tracked block keeps its tracking through the resize instead of being unregistered and registered again
+    void* new_ptr = NULL;
+    if (ptr && memm_resize_allocation(ptr, size, callsite, &new_ptr)) {
+        #ifdef MEMM_ENABLE_LOGGING
+        if (!new_ptr && size > 0) {
+            fprintf(stderr, "MEMM-ERROR: realloc failed for %zu bytes (%s:%d)\n", size, site->file, site->line);
+        }
+        #endif
+        return new_ptr;
+    }
+
+    #ifdef MEMM_INLINE_HEADERS
+    // blocks without a header were not allocated by memm, resize them untracked, as well as those tracked before the last memm_init
+    if (ptr) {
+        return memm_passthrough(memm_stale_header(ptr) ? memm_block_realloc(ptr, size) : memm_system_realloc(ptr, size), size);
+    }
+    #endif
+
+    if (ptr && !memm_unregister_allocation(ptr, MEMM_UNKNOWN_SIZE, site->file, site->line)) {
+        #ifdef MEMM_ENABLE_LOGGING
+        if (!memm_atomic_load(&g_memm.untracked_blocks)) {
+            fprintf(stderr, "MEMM-WARN: realloc on an untracked memory %p (%s:%d)\n", ptr, site->file, site->line);
+        }
+        #endif
+    }
+    
+    new_ptr = memm_block_realloc(ptr, size);
+    if (new_ptr) {
+        memm_register_allocation(new_ptr, size, callsite);
+    } 
+
+    else if (size > 0) {
+        #ifdef MEMM_ENABLE_LOGGING
+        fprintf(stderr, "MEMM-ERROR: realloc failed for %zu bytes (%s:%d)\n", size, site->file, site->line);
+        #endif
+    }
+    return new_ptr;
+}
+
+MEMM_API void memm_free(void *ptr, const char *file, int line)
+{
+    memm_free_sized(ptr, MEMM_UNKNOWN_SIZE, file, line);
+}
+
+MEMM_API void memm_free_sized(void *ptr, size_t size, const char *file, int line)
+{
+    if (memm_unregister_allocation(ptr, size, file, line)) {
+        if (ptr) {
+            memm_block_free(ptr);
+        }
+    } 
+
+    else {
+        // if not found in our tracking, still free it to avoid real leaks
+        memm_free_untracked(ptr, file, line);
+    }
+}
+
+MEMM_API char* memm_strdup(const char* str, const char* file, int line)
+{
+    return memm_strdup_at(str, memm_intern_callsite(file, line));
+}
+
+MEMM_API char* memm_strdup_at(const char* str, uint32_t callsite)
+{
+    size_t size = strlen(str) + 1;
+    char* copy = (char*)memm_malloc_at(size, callsite);
+    return copy ? (char*)memcpy(copy, str, size) : NULL;
+}
+
+MEMM_API char* memm_strndup(const char* str, size_t size, const char* file, int line)
+{
+    return memm_strndup_at(str, size, memm_intern_callsite(file, line));
+}
+
+MEMM_API char* memm_strndup_at(const char* str, size_t size, uint32_t callsite)
 {
-    memm_allocation_t* hash_table[MEMM_HASH_TABLE_SIZE];
-    size_t total_allocated;     // bytes allocated
-    size_t total_freed;         // bytes freed
-    size_t peak_memory;         // max memory simultaneosly allocated, used 
-    size_t allocation_count;    // allocations calls count
-    size_t free_count;          // free calls count
-} memm_t;
+    const char* end = (const char*)memchr(str, '\0', size);
+    size_t length = end ? (size_t)(end - str) : size;
+    if (length == (size_t)-1) return NULL;
 
-/// @brief global state
-static memm_t g_memm = { 0 };
+    char* copy = (char*)memm_malloc_at(length + 1, callsite);
+    if (!copy) return NULL;
 
-/// @brief hashes the function 
-static size_t memm_hash_ptr(void* ptr) {
-    return ((size_t)ptr) & (MEMM_HASH_TABLE_SIZE - 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
 }
 
-/// @brief register an allocation
-static void memm_register_allocation(void* ptr, size_t size, const char* file, int line)
+MEMM_API void* memm_reallocarray(void* ptr, size_t num, size_t size, const char* file, int line)
 {
-    if (!ptr) return;
-    
-    size_t hash = memm_hash_ptr(ptr);
-    memm_allocation_t* alloc = (memm_allocation_t*)malloc(sizeof(memm_allocation_t));
-    
-    if (!alloc) {
+    return memm_reallocarray_at(ptr, num, size, memm_intern_callsite(file, line));
+}
+
+MEMM_API void* memm_reallocarray_at(void* ptr, size_t num, size_t size, uint32_t callsite)
+{
+    if (size != 0 && num > (size_t)-1 / size) {
         #ifdef MEMM_ENABLE_LOGGING
-        fprintf(stderr, "MEMM-ERROR: Failed to register allocation for %p\n", ptr);
+        fprintf(stderr, "MEMM-ERROR: reallocarray of %zu elements of %zu bytes overflows (%s:%d)\n", num, size, memm_callsite_get(callsite)->file, memm_callsite_get(callsite)->line);
         #endif
-        return;
-    }
-    
-    alloc->ptr = ptr;
-    alloc->size = size;
-    alloc->file = file;
-    alloc->line = line;
-    alloc->timestamp = time(NULL);
-    alloc->next = g_memm.hash_table[hash];
-    g_memm.hash_table[hash] = alloc;
-    
-    g_memm.total_allocated += size;
-    g_memm.allocation_count++;
-    
-    size_t current_usage = g_memm.total_allocated - g_memm.total_freed;
-    if (current_usage > g_memm.peak_memory) {
-        g_memm.peak_memory = current_usage;
+        errno = ENOMEM;
+        return NULL;
     }
+    return memm_realloc_at(ptr, num * size, callsite);
 }
 
-/// @brief unregister the allocation
-static bool memm_unregister_allocation(void* ptr, const char* file, int line)
+MEMM_API int memm_asprintf(char** out, const char* file, int line, const char* format, ...)
 {
-    if (!ptr) return true;
-    
-    size_t hash = memm_hash_ptr(ptr);
-    memm_allocation_t** current = &g_memm.hash_table[hash];
-    
-    while (*current) {
-        if ((*current)->ptr == ptr) {
-            memm_allocation_t* to_free = *current;
-            *current = to_free->next;
-            
-            g_memm.total_freed += to_free->size;
-            g_memm.free_count++;
-            
-            free(to_free);
-            return true;
-        }
-        current = &(*current)->next;
-    }
-    
-    #ifdef MEMM_ENABLE_LOGGING
-    fprintf(stderr, "MEMM-ERROR: Attempt to free unknown pointer %p (%s:%d)\n", ptr, file, line);
-    #endif
-    return false;
+    va_list args;
+    va_start(args, format);
+    int length = memm_vasprintf_at(out, memm_intern_callsite(file, line), format, args);
+    va_end(args);
+    return length;
 }
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////// External Implementations
+MEMM_API int memm_asprintf_at(char** out, uint32_t callsite, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int length = memm_vasprintf_at(out, callsite, format, args);
+    va_end(args);
+    return length;
+}
 
-MEMM_API void memm_init()
+MEMM_API int memm_vasprintf(char** out, const char* file, int line, const char* format, va_list args)
 {
-    memset(&g_memm, 0, sizeof(g_memm));
-    #ifdef MEMM_ENABLE_LOGGING
-    printf("Memory manager initialized with %d buckets\n", MEMM_HASH_TABLE_SIZE);
-    #endif
+    return memm_vasprintf_at(out, memm_intern_callsite(file, line), format, args);
 }
 
-MEMM_API void memm_shutdown()
+MEMM_API int memm_vasprintf_at(char** out, uint32_t callsite, const char* format, va_list args)
+{
+    // the arguments are walked twice, once to measure and once to print
+    va_list measure;
+    va_copy(measure, args);
+    int length = vsnprintf(NULL, 0, format, measure);
+    va_end(measure);
+
+    *out = NULL;
+    if (length < 0) return -1;
+
+    char* buffer = (char*)memm_malloc_at((size_t)length + 1, callsite);
+    if (!buffer) return -1;
+
+    vsnprintf(buffer, (size_t)length + 1, format, args);
+    *out = buffer;
+    return length;
+}
+
+MEMM_API ptrdiff_t memm_getline(char** lineptr, size_t* size, FILE* stream, const char* file, int line)
+{
+    return memm_getdelim_at(lineptr, size, '\n', stream, memm_intern_callsite(file, line));
+}
+
+MEMM_API ptrdiff_t memm_getline_at(char** lineptr, size_t* size, FILE* stream, uint32_t callsite)
 {
-    // cleanup tracking structures
-    for (size_t i = 0; i < MEMM_HASH_TABLE_SIZE; i++) {
-        memm_allocation_t* current = g_memm.hash_table[i];
-        while (current) {
-            memm_allocation_t* next = current->next;
-            free(current);
-            current = next;
+    return memm_getdelim_at(lineptr, size, '\n', stream, callsite);
+}
+
+MEMM_API ptrdiff_t memm_getdelim(char** lineptr, size_t* size, int delimiter, FILE* stream, const char* file, int line)
+{
+    return memm_getdelim_at(lineptr, size, delimiter, stream, memm_intern_callsite(file, line));
+}
+
+MEMM_API ptrdiff_t memm_getdelim_at(char** lineptr, size_t* size, int delimiter, FILE* stream, uint32_t callsite)
+{
+    if (!lineptr || !size || !stream) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (!*lineptr) {
+        *size = 0;
+    }
+
+    // the stream is locked once for the whole line instead of on every character
+    #if defined(_WIN32) || defined(_WIN64)
+    #define memm_getc(stream) _getc_nolock(stream)
+    _lock_file(stream);
+    #else
+    #define memm_getc(stream) getc_unlocked(stream)
+    flockfile(stream);
+    #endif
+
+    size_t length = 0;
+    bool failed = false;
+    int c;
+    while ((c = memm_getc(stream)) != EOF) {
+        // room for the character and the terminator, the buffer grows through memm_realloc_at so it stays tracked
+        if (length + 2 > *size) {
+            size_t new_size = *size < 64 ? 128 : *size * 2;
+            char* grown = new_size > *size ? (char*)memm_realloc_at(*lineptr, new_size, callsite) : NULL;
+            if (!grown) {
+                errno = ENOMEM;
+                failed = true;
+                break;
+            }
+            *lineptr = grown;
+            *size = new_size;
         }
-        g_memm.hash_table[i] = NULL;
+
+        (*lineptr)[length++] = (char)c;
+        if (c == delimiter) break;
     }
-    #ifdef MEMM_ENABLE_LOGGING
-    printf("Memory manager shutdown complete\n");
+
+    #if defined(_WIN32) || defined(_WIN64)
+    _unlock_file(stream);
+    #else
+    funlockfile(stream);
     #endif
+    #undef memm_getc
+
+    if (failed || length == 0) return -1;
+
+    (*lineptr)[length] = '\0';
+    return (ptrdiff_t)length;
 }
 
-MEMM_API void* memm_malloc(size_t size, const char* file, int line)
+MEMM_API size_t memm_malloc_batch(size_t size, size_t count, void** out_ptrs, const char* file, int line)
 {
-    void* ptr = malloc(size);
-    if (ptr) {
-        memm_register_allocation(ptr, size, file, line);
-    } 
+    return memm_malloc_batch_at(size, count, out_ptrs, memm_intern_callsite(file, line));
+}
 
-    else {
+MEMM_API size_t memm_malloc_batch_at(size_t size, size_t count, void** out_ptrs, uint32_t callsite)
+{
+    size_t allocated = 0;
+    while (allocated < count && (out_ptrs[allocated] = memm_block_malloc(size)) != NULL) {
+        allocated++;
+    }
+
+    memm_register_batch(out_ptrs, allocated, size, callsite);
+    if (allocated < count) {
+        memset(out_ptrs + allocated, 0, (count - allocated) * sizeof(void*));
         #ifdef MEMM_ENABLE_LOGGING
-        fprintf(stderr, "MEMM-ERROR: malloc failed for %zu bytes (%s:%d)\n", size, file, line);
+        fprintf(stderr, "MEMM-ERROR: batch malloc failed after %zu of %zu blocks of %zu bytes (%s:%d)\n", allocated, count, size, memm_callsite_get(callsite)->file, memm_callsite_get(callsite)->line);
         #endif
     }
-    return ptr;
+    return allocated;
 }
 
-MEMM_API void* memm_calloc(size_t num, size_t size, const char *file, int line)
+MEMM_API void memm_free_batch(void** ptrs, size_t count)
 {
-    void* ptr = calloc(num, size);
-    if (ptr) {
-        memm_register_allocation(ptr, num * size, file, line);
-    } 
+    memm_free_batch_blocks(ptrs, count);
+}
 
-    else {
+MEMM_API memm_arena_t* memm_arena_create(size_t chunk_size, const char* file, int line)
+{
+    return memm_arena_create_at(chunk_size, memm_intern_callsite(file, line));
+}
+
+MEMM_API memm_arena_t* memm_arena_create_at(size_t chunk_size, uint32_t callsite)
+{
+    memm_arena_t* arena = (memm_arena_t*)memm_libc_calloc(1, sizeof(memm_arena_t));
+    if (!arena) {
         #ifdef MEMM_ENABLE_LOGGING
-        fprintf(stderr, "MEMM-ERROR: calloc failed for %zu elements of %zu bytes (%s:%d)\n", num, size, file, line);
+        fprintf(stderr, "MEMM-ERROR: Failed to create an arena (%s:%d)\n", memm_callsite_get(callsite)->file, memm_callsite_get(callsite)->line);
         #endif
+        return NULL;
+    }
+
+    arena->chunk_size = chunk_size ? chunk_size : MEMM_ARENA_CHUNK_SIZE;
+    arena->callsite = callsite;
+    arena->level = memm_atomic_load(&g_memm_level);
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    arena->timestamp = memm_clock_ticks();
+    #endif
+
+    if (arena->level != MEMM_LEVEL_OFF) {
+        memm_lock_acquire(&g_memm_arenas.lock);
+        arena->next = g_memm_arenas.head;
+        if (g_memm_arenas.head) g_memm_arenas.head->prev = arena;
+        g_memm_arenas.head = arena;
+        memm_lock_release(&g_memm_arenas.lock);
+    }
+    return arena;
+}
+
+MEMM_API void* memm_arena_alloc(memm_arena_t* arena, size_t size)
+{
+    if (!arena) return NULL;
+
+    // zero-sized blocks still get a distinct address, like from malloc
+    size_t padded = size ? size : 1;
+    if (padded > SIZE_MAX - MEMM_ARENA_ALIGNMENT) return NULL;
+    padded = (padded + MEMM_ARENA_ALIGNMENT - 1) & ~(size_t)(MEMM_ARENA_ALIGNMENT - 1);
+
+    // chunks left over from before a reset are reused before new ones are reserved
+    while ((size_t)(arena->end - arena->bump) < padded) {
+        memm_arena_chunk_t* next = arena->current ? arena->current->next : NULL;
+        if (next && next->capacity >= padded) {
+            memm_arena_use(arena, next);
+        }
+
+        else if (!memm_arena_grow(arena, padded)) {
+            #ifdef MEMM_ENABLE_LOGGING
+            fprintf(stderr, "MEMM-ERROR: Arena %p failed to allocate %zu bytes (%s:%d)\n", (void*)arena, size, memm_callsite_get(arena->callsite)->file, memm_callsite_get(arena->callsite)->line);
+            #endif
+            return NULL;
+        }
+    }
+
+    void* ptr = arena->bump;
+    arena->bump += padded;
+    memm_atomic_store(&arena->used_bytes, arena->used_bytes + padded);
+    memm_atomic_store(&arena->object_count, arena->object_count + 1);
+    if (arena->used_bytes > arena->peak_used_bytes) {
+        memm_atomic_store(&arena->peak_used_bytes, arena->used_bytes);
     }
     return ptr;
 }
 
-MEMM_API void* memm_realloc(void *ptr, size_t size, const char *file, int line)
+MEMM_API void memm_arena_reset(memm_arena_t* arena)
 {
-    if (ptr) {
-        memm_unregister_allocation(ptr, file, line);
+    if (!arena) return;
+
+    // the chunks stay reserved, so the global statistics don't change
+    if (arena->chunks) {
+        memm_arena_use(arena, arena->chunks);
     }
-    
-    void* new_ptr = realloc(ptr, size);
-    if (new_ptr) {
-        memm_register_allocation(new_ptr, size, file, line);
-    } 
+    memm_atomic_store(&arena->used_bytes, 0);
+    memm_atomic_store(&arena->object_count, 0);
+    memm_atomic_store(&arena->reset_count, arena->reset_count + 1);
+}
 
-    else if (size > 0) {
+MEMM_API void memm_arena_destroy(memm_arena_t* arena)
+{
+    if (!arena) return;
+
+    memm_lock_acquire(&g_memm_arenas.lock);
+    size_t level = arena->level;
+    if (level != MEMM_LEVEL_OFF) {
+        if (arena->prev) arena->prev->next = arena->next;
+        else g_memm_arenas.head = arena->next;
+        if (arena->next) arena->next->prev = arena->prev;
+    }
+    memm_lock_release(&g_memm_arenas.lock);
+
+    // every chunk is accounted as a block freed at once, living as long as the arena
+    if (level != MEMM_LEVEL_OFF && arena->chunk_count) {
+        if (level >= MEMM_LEVEL_CALLSITES) {
+            memm_callsite_count_free(arena->callsite, arena->chunk_count, arena->reserved_bytes, level == MEMM_LEVEL_FULL ? memm_allocation_timestamp(arena) : 0);
+        }
+        memm_counters_count_free(arena->chunk_count, arena->reserved_bytes);
+    }
+
+    memm_arena_chunk_t* chunk = arena->chunks;
+    while (chunk) {
+        memm_arena_chunk_t* next = chunk->next;
+        memm_libc_free(chunk);
+        chunk = next;
+    }
+    memm_libc_free(arena);
+}
+
+MEMM_API bool memm_get_arena_stats(const memm_arena_t* arena, memm_arena_stats_t* stats)
+{
+    if (!arena || !stats) return false;
+
+    memm_callsite_t* site = memm_callsite_get(arena->callsite);
+    stats->callsite = arena->callsite;
+    stats->file = site->file;
+    stats->line = site->line;
+    stats->chunk_count = memm_atomic_load(&arena->chunk_count);
+    stats->reserved_bytes = memm_atomic_load(&arena->reserved_bytes);
+    stats->used_bytes = memm_atomic_load(&arena->used_bytes);
+    stats->object_count = memm_atomic_load(&arena->object_count);
+    stats->peak_used_bytes = memm_atomic_load(&arena->peak_used_bytes);
+    stats->reset_count = memm_atomic_load(&arena->reset_count);
+    return true;
+}
+
+MEMM_API memm_pool_t* memm_pool_create(size_t object_size, size_t objects_per_slab, const char* file, int line)
+{
+    return memm_pool_create_at(object_size, objects_per_slab, memm_intern_callsite(file, line));
+}
+
+MEMM_API memm_pool_t* memm_pool_create_at(size_t object_size, size_t objects_per_slab, uint32_t callsite)
+{
+    // objects are kept 16-byte aligned like malloc blocks
+    size_t rounded = object_size > SIZE_MAX - 15 ? 0 : ((object_size ? object_size : 1) + 15) & ~(size_t)15;
+    size_t per_slab = objects_per_slab ? objects_per_slab : MEMM_POOL_SLAB_SIZE;
+    memm_pool_t* pool = rounded && rounded <= (SIZE_MAX - MEMM_SLAB_HEADER_SIZE) / per_slab ? (memm_pool_t*)memm_libc_calloc(1, sizeof(memm_pool_t)) : NULL;
+    if (!pool) {
         #ifdef MEMM_ENABLE_LOGGING
-        fprintf(stderr, "MEMM-ERROR: realloc failed for %zu bytes (%s:%d)\n", size, file, line);
+        fprintf(stderr, "MEMM-ERROR: Failed to create a pool of %zu byte objects (%s:%d)\n", object_size, memm_callsite_get(callsite)->file, memm_callsite_get(callsite)->line);
         #endif
+        return NULL;
     }
-    return new_ptr;
+
+    memm_lock_init(&pool->lock);
+    memm_slab_pool_init(&pool->slabs, rounded, per_slab);
+    pool->slab_bytes = MEMM_SLAB_HEADER_SIZE + pool->slabs.object_size * pool->slabs.objects_per_slab;
+    pool->callsite = callsite;
+    pool->level = memm_atomic_load(&g_memm_level);
+    #if MEMM_CLOCK_SOURCE != MEMM_CLOCK_NONE
+    pool->timestamp = memm_clock_ticks();
+    #endif
+
+    if (pool->level != MEMM_LEVEL_OFF) {
+        memm_lock_acquire(&g_memm_pools.lock);
+        pool->next = g_memm_pools.head;
+        if (g_memm_pools.head) g_memm_pools.head->prev = pool;
+        g_memm_pools.head = pool;
+        memm_lock_release(&g_memm_pools.lock);
+    }
+    return pool;
 }
 
-MEMM_API void memm_free(void *ptr, const char *file, int line)
+MEMM_API void* memm_pool_alloc(memm_pool_t* pool)
 {
-    if (memm_unregister_allocation(ptr, file, line)) {
-        free(ptr);
-    } 
+    if (!pool) return NULL;
 
-    else {
+    memm_lock_acquire(&pool->lock);
+    size_t slab_count = pool->slabs.slab_count;
+    void* ptr = memm_slab_pool_get(&pool->slabs);
+    if (!ptr) {
+        memm_lock_release(&pool->lock);
         #ifdef MEMM_ENABLE_LOGGING
-        fprintf(stderr, "MEMM-WARN: free on %zu bytes on an untracked memory (%s:%d)\n", size, file, line);
+        fprintf(stderr, "MEMM-ERROR: Pool %p failed to allocate a %zu byte object (%s:%d)\n", (void*)pool, pool->slabs.object_size, memm_callsite_get(pool->callsite)->file, memm_callsite_get(pool->callsite)->line);
         #endif
-        // if not found in our tracking, still free it to avoid real leaks
-        free(ptr);
+        return NULL;
+    }
+
+    // a new slab is accounted like a block, the objects carved from it are not
+    if (pool->slabs.slab_count != slab_count) {
+        memm_atomic_store(&pool->slab_count, pool->slab_count + 1);
+        memm_atomic_store(&pool->capacity, pool->capacity + pool->slabs.objects_per_slab);
+        memm_atomic_store(&pool->reserved_bytes, pool->reserved_bytes + pool->slab_bytes);
+        if (pool->level >= MEMM_LEVEL_COUNTERS) {
+            memm_count_allocation(pool->slab_bytes, pool->callsite, pool->level);
+        }
+    }
+
+    memm_atomic_store(&pool->live_count, pool->live_count + 1);
+    if (pool->live_count > pool->peak_count) {
+        memm_atomic_store(&pool->peak_count, pool->live_count);
+    }
+    memm_lock_release(&pool->lock);
+    return ptr;
+}
+
+MEMM_API void memm_pool_free(memm_pool_t* pool, void* ptr)
+{
+    if (!pool || !ptr) return;
+
+    memm_lock_acquire(&pool->lock);
+    memm_slab_pool_put(&pool->slabs, ptr);
+    memm_atomic_store(&pool->live_count, pool->live_count - 1);
+    memm_lock_release(&pool->lock);
+}
+
+MEMM_API void memm_pool_destroy(memm_pool_t* pool)
+{
+    if (!pool) return;
+
+    memm_lock_acquire(&g_memm_pools.lock);
+    size_t level = pool->level;
+    if (level != MEMM_LEVEL_OFF) {
+        if (pool->prev) pool->prev->next = pool->next;
+        else g_memm_pools.head = pool->next;
+        if (pool->next) pool->next->prev = pool->prev;
+    }
+    memm_lock_release(&g_memm_pools.lock);
+
+    #ifdef MEMM_ENABLE_LOGGING
+    if (level == MEMM_LEVEL_FULL && pool->live_count) {
+        memm_callsite_t* site = memm_callsite_get(pool->callsite);
+        fprintf(stderr, "MEMM-WARN: pool %p destroyed with %zu live objects of %zu bytes (%s:%d)\n", (void*)pool, pool->live_count, pool->slabs.object_size, site->file, site->line);
+    }
+    #endif
+
+    // every slab is accounted as a block freed at once, living as long as the pool
+    if (level != MEMM_LEVEL_OFF && pool->slab_count) {
+        if (level >= MEMM_LEVEL_CALLSITES) {
+            memm_callsite_count_free(pool->callsite, pool->slab_count, pool->reserved_bytes, level == MEMM_LEVEL_FULL ? memm_allocation_timestamp(pool) : 0);
+        }
+        memm_counters_count_free(pool->slab_count, pool->reserved_bytes);
     }
+
+    memm_slab_pool_release(&pool->slabs);
+    memm_libc_free(pool);
+}
+
+MEMM_API bool memm_get_pool_stats(const memm_pool_t* pool, memm_pool_stats_t* stats)
+{
+    if (!pool || !stats) return false;
+
+    memm_callsite_t* site = memm_callsite_get(pool->callsite);
+    stats->callsite = pool->callsite;
+    stats->file = site->file;
+    stats->line = site->line;
+    stats->object_size = pool->slabs.object_size;
+    stats->live_count = memm_atomic_load(&pool->live_count);
+    stats->peak_count = memm_atomic_load(&pool->peak_count);
+    stats->capacity = memm_atomic_load(&pool->capacity);
+    stats->slab_count = memm_atomic_load(&pool->slab_count);
+    stats->reserved_bytes = memm_atomic_load(&pool->reserved_bytes);
+    return true;
 }
 
 MEMM_API size_t memm_get_current_usage()
 {
-    return g_memm.total_allocated - g_memm.total_freed;
+    memm_counters_t sum;
+    memm_counters_sum(&sum);
+    return sum.total_allocated > sum.total_freed ? sum.total_allocated - sum.total_freed : 0;
 }
 
 MEMM_API size_t memm_get_peak_usage()
 {
-    return g_memm.peak_memory;
+    // the published peak lags by less than MEMM_PEAK_PUBLISH_BYTES per thread, the exact current usage may be higher
+    memm_atomic_max(&g_memm.peak_memory, memm_get_current_usage());
+    return memm_atomic_load(&g_memm.peak_memory);
 }
 
 MEMM_API size_t memm_get_allocation_count()
  {
-    return g_memm.allocation_count;
+    memm_counters_t sum;
+    memm_counters_sum(&sum);
+    return sum.allocation_count;
 }
 
 MEMM_API size_t memm_get_free_count()
  {
-    return g_memm.free_count;
+    memm_counters_t sum;
+    memm_counters_sum(&sum);
+    return sum.free_count;
 }
 
-MEMM_API int memm_get_stats_string(char *buffer, size_t buffer_size)
+MEMM_API bool memm_get_size_histogram(memm_size_histogram_t* histogram)
 {
-    if(!buffer || buffer_size <= 0) {
-        return -1;
-    }
-
-    int written = snprintf(buffer, buffer_size,
-        "=== MEMORY STATISTICS ===\n"
-        "Total allocated:      %zu bytes\n"
-        "Total freed:          %zu bytes\n"
-        "Current usage:        %zu bytes\n"
-        "Peak memory usage:    %zu bytes\n"
-        "Allocation calls:     %zu\n"
-        "Free calls:           %zu\n"
-        "Potential leaks:      %zu objects\n"
-        "Hash table size:      %d buckets\n",
-        g_memm.total_allocated,
-        g_memm.total_freed,
-        memm_get_current_usage(),
-        memm_get_peak_usage(),
-        memm_get_allocation_count(),
-        memm_get_free_count(),
-        memm_get_allocation_count() - memm_get_free_count(),
-        MEMM_HASH_TABLE_SIZE
-    );
+    if (!histogram) return false;
 
-    if (written < 0) {
-        buffer[0] = '\0';
-        return -1;
-    }
-    
-    if ((size_t)written >= buffer_size) {
-        buffer[buffer_size - 1] = '\0';
-        return buffer_size - 1;
+    memm_size_classes_sum(histogram->counts);
+    histogram->allocation_count = 0;
+    for (size_t i = 0; i < MEMM_SIZE_BUCKETS; i++) {
+        histogram->lower_bounds[i] = memm_size_class_lower_bound(i);
+        histogram->allocation_count += histogram->counts[i];
     }
-    
-    return written;
+    return true;
 }
 
-MEMM_API int memm_get_allocations_string(char *buffer, size_t buffer_size)
+MEMM_API bool memm_get_table_stats(memm_table_stats_t* stats)
 {
-    if (!buffer || buffer_size == 0) {
-        return -1;
+    #ifdef MEMM_INLINE_HEADERS
+    // there is no index to report on, headers are found by subtraction
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
     }
-    
-    char* cursor = buffer;
-    size_t remaining = buffer_size;
-    int total_written = 0;
-    int written = 0;
-    
-    written = snprintf(cursor, remaining, "=== CURRENT ALLOCATIONS ===\n");
-    if (written < 0) {
-        buffer[0] = '\0';
-        return -1;
+    return false;
+    #else
+    if (!stats) {
+        return false;
     }
 
-    if ((size_t)written >= remaining) {
-        buffer[buffer_size - 1] = '\0';
-        return buffer_size - 1;
-    }
+    memset(stats, 0, sizeof(*stats));
+    size_t total_probe = 0;
+    for (size_t s = 0; s < MEMM_SHARD_COUNT; s++) {
+        memm_shard_t* shard = &g_memm.shards[s];
+        memm_lock_acquire(&shard->lock);
 
-    cursor += written;
-    remaining -= written;
-    total_written += written;
-    
-    size_t total_count = 0;
-    size_t total_bytes = 0;
-    
-    for (size_t i = 0; i < MEMM_HASH_TABLE_SIZE && remaining > 1; i++) {
-        memm_allocation_t* current = g_memm.hash_table[i];
-        while (current && remaining > 1) {
-            written = snprintf(cursor, remaining, "  %p: %6zu bytes @ %s:%d\n", current->ptr, current->size, current->file, current->line);
-            
-            if (written < 0) break;
-            if ((size_t)written >= remaining) written = remaining - 1;
-            
-            cursor += written;
-            remaining -= written;
-            total_written += written;
-            total_count++;
-            total_bytes += current->size;
-            current = current->next;
-        }
-    }
-    
-    if (total_count == 0 && remaining > 1) {
-        written = snprintf(cursor, remaining, "  No active allocations\n");
-        if (written > 0) {
-            if ((size_t)written >= remaining) {
-                written = remaining - 1;
+        memm_index_t* index = &shard->index;
+        stats->capacity += index->capacity;
+        stats->entries += index->count;
+        stats->draining_entries += index->old_slots ? index->old_count : 0;
+
+        // robin hood keeps entries sharing a home slot contiguous, so every chain is a run of equal homes
+        size_t chain_length = 0;
+        size_t previous_home = (size_t)-1;
+        for (size_t i = 0; i < index->capacity; i++) {
+            if (!index->slots[i].ptr) {
+                previous_home = (size_t)-1;
+                continue;
             }
-            total_written += written;
-        }
-    }
 
-    else if (remaining > 1) {
-        written = snprintf(cursor, remaining, "  Total: %zu allocations, %zu bytes\n", total_count, total_bytes);
-        if (written > 0) {
-            if ((size_t)written >= remaining) {
-                written = remaining - 1;
+            size_t probe = memm_index_distance(index, i);
+            size_t home = (i - probe) & (index->capacity - 1);
+            total_probe += probe;
+            if (probe > stats->max_probe_length) {
+                stats->max_probe_length = probe;
+            }
+            stats->probe_length_histogram[probe < MEMM_PROBE_HISTOGRAM_SIZE ? probe : MEMM_PROBE_HISTOGRAM_SIZE - 1]++;
+
+            if (home != previous_home) {
+                stats->used_home_slots++;
+                chain_length = 0;
+                previous_home = home;
+            }
+            if (++chain_length > stats->max_chain_length) {
+                stats->max_chain_length = chain_length;
             }
-            total_written += written;
         }
+        memm_lock_release(&shard->lock);
     }
-    
-    // ensure null termination
-    if (remaining == 0 && buffer_size > 0) {
-        buffer[buffer_size - 1] = '\0';
+
+    if (stats->capacity > 0) {
+        stats->load_factor = (double)stats->entries / (double)stats->capacity;
+        stats->home_slot_occupancy = (double)stats->used_home_slots / (double)stats->capacity;
     }
-    
-    return total_written;
+
+    if (stats->entries > 0) {
+        stats->average_chain_length = (double)stats->entries / (double)stats->used_home_slots;
+        stats->average_probe_length = (double)total_probe / (double)stats->entries;
+    }
+    stats->hash_function = memm_hash_name();
+    return true;
+    #endif
+}
+
+MEMM_API int memm_get_stats_string(char *buffer, size_t buffer_size)
+{
+    return memm_report_to_buffer(buffer, buffer_size, memm_report_stats, 0, MEMM_SORT_LIVE_BYTES);
+}
+
+MEMM_API int memm_get_allocations_string(char *buffer, size_t buffer_size)
+{
+    return memm_report_to_buffer(buffer, buffer_size, memm_report_allocations, 0, MEMM_SORT_LIVE_BYTES);
 }
 
 MEMM_API int memm_get_leaks_string(char *buffer, size_t buffer_size)
 {
-    if (!buffer || buffer_size == 0) {
-        return -1;
-    }
-    
-    char* cursor = buffer;
-    size_t remaining = buffer_size;
-    int total_written = 0;
-    int written = 0;
-    
-    written = snprintf(cursor, remaining, "=== MEMORY LEAK REPORT ===\n");
-    if (written < 0) {
-        buffer[0] = '\0';
-        return -1;
-    }
+    return memm_report_to_buffer(buffer, buffer_size, memm_report_leaks, 0, MEMM_SORT_LIVE_BYTES);
+}
 
-    if ((size_t)written >= remaining) {
-        buffer[buffer_size - 1] = '\0';
-        return buffer_size - 1;
-    }
+MEMM_API int memm_get_top_callsites_string(char *buffer, size_t buffer_size, size_t n, memm_sort_key_t sort_key)
+{
+    return memm_report_to_buffer(buffer, buffer_size, memm_report_top_callsites, n, sort_key);
+}
 
-    cursor += written;
-    remaining -= written;
-    total_written += written;
-    
-    size_t leak_count = 0;
-    size_t leak_bytes = 0;
-    
-    for (size_t i = 0; i < MEMM_HASH_TABLE_SIZE && remaining > 1; i++) {
-        memm_allocation_t* current = g_memm.hash_table[i];
-        while (current && remaining > 1) {
-            written = snprintf(cursor, remaining, "  LEAK: %6zu bytes at %p (%s:%d)\n", current->size, current->ptr, current->file, current->line);
-            
-            if (written < 0) break;
-            if ((size_t)written >= remaining) written = remaining - 1;
-            
-            cursor += written;
-            remaining -= written;
-            total_written += written;
-            leak_count++;
-            leak_bytes += current->size;
-            current = current->next;
-        }
-    }
-    
-    if (leak_count == 0 && remaining > 1) {
-        written = snprintf(cursor, remaining, "  No memory leaks detected!\n");
-        if (written > 0) {
-            if ((size_t)written >= remaining) {
-                written = remaining - 1;
-            }
-            total_written += written;
-        }
-    }
+MEMM_API int memm_get_lifetimes_string(char *buffer, size_t buffer_size, size_t n)
+{
+    return memm_report_to_buffer(buffer, buffer_size, memm_report_lifetimes, n, MEMM_SORT_FREED_COUNT);
+}
 
-    else if (remaining > 1) {
-        written = snprintf(cursor, remaining, "  TOTAL LEAKS: %zu allocations, %zu bytes\n", leak_count, leak_bytes);
-        if (written > 0) {
-            if ((size_t)written >= remaining) {
-                written = remaining - 1;
-            }
-            total_written += written;
+MEMM_API bool memm_write_stats(memm_write_fn write, void* user)
+{
+    return memm_report_to_callback(write, user, memm_report_stats, 0, MEMM_SORT_LIVE_BYTES);
+}
+
+MEMM_API bool memm_write_allocations(memm_write_fn write, void* user)
+{
+    return memm_report_to_callback(write, user, memm_report_allocations, 0, MEMM_SORT_LIVE_BYTES);
+}
+
+MEMM_API bool memm_write_leaks(memm_write_fn write, void* user)
+{
+    return memm_report_to_callback(write, user, memm_report_leaks, 0, MEMM_SORT_LIVE_BYTES);
+}
+
+MEMM_API bool memm_write_top_callsites(memm_write_fn write, void* user, size_t n, memm_sort_key_t sort_key)
+{
+    return memm_report_to_callback(write, user, memm_report_top_callsites, n, sort_key);
+}
+
+MEMM_API bool memm_write_lifetimes(memm_write_fn write, void* user, size_t n)
+{
+    return memm_report_to_callback(write, user, memm_report_lifetimes, n, MEMM_SORT_FREED_COUNT);
+}
+
+MEMM_API bool memm_file_writer(void* file, const char* data, size_t size)
+{
+    return file && fwrite(data, 1, size, (FILE*)file) == size;
+}
+
+MEMM_API bool memm_fd_writer(void* fd, const char* data, size_t size)
+{
+    // retries partial writes, a pipe or socket may accept less than a chunk at a time
+    while (size > 0) {
+        #if defined(_WIN32) || defined(_WIN64)
+        int written = _write((int)(intptr_t)fd, data, (unsigned int)size);
+        #else
+        ssize_t written = write((int)(intptr_t)fd, data, size);
+        #endif
+        if (written <= 0) {
+            return false;
         }
+        data += written;
+        size -= (size_t)written;
     }
-    
-    // ensure null termination
-    if (remaining == 0 && buffer_size > 0) {
-        buffer[buffer_size - 1] = '\0';
-    }
-    
-    return total_written;
+    return true;
 }
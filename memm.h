@@ -3,17 +3,176 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
 
-/// @brief sets how many allocations the system can hold information about
+/// @brief sets the initial capacity of the pointer index, it grows on demand so any amount of allocations can be tracked
 #ifndef MEMM_HASH_TABLE_SIZE
     #define MEMM_HASH_TABLE_SIZE 2048
 #endif
 
 /// @brief compile-time validation that size is power of 2
-#if (MEMM_HASH_TABLE_SIZE & (MEMM_HASH_TABLE_SIZE - 1)) != 0
+#if MEMM_HASH_TABLE_SIZE < 1 || (MEMM_HASH_TABLE_SIZE & (MEMM_HASH_TABLE_SIZE - 1)) != 0
     #error "MEMM_HASH_TABLE_SIZE must be a power of 2 for hashing efficiency"
 #endif
 
+/// @brief sets how many tracking records are carved from each slab of the internal record pool
+#ifndef MEMM_RECORD_SLAB_SIZE
+    #define MEMM_RECORD_SLAB_SIZE 4096
+#endif
+
+/// @brief sets how many independently locked shards the tracking structures are split into, MEMM_THREAD_SAFE only
+#ifdef MEMM_THREAD_SAFE
+    #ifndef MEMM_SHARD_COUNT
+        #define MEMM_SHARD_COUNT 16
+    #endif
+#else
+    #undef MEMM_SHARD_COUNT
+    #define MEMM_SHARD_COUNT 1
+#endif
+
+/// @brief sets how many bytes of growth a thread accumulates before publishing it to the shared peak estimate, MEMM_THREAD_SAFE only
+/// the reported peak may be off by up to this amount per thread, in exchange allocations don't touch shared cache lines
+#ifdef MEMM_THREAD_SAFE
+    #ifndef MEMM_PEAK_PUBLISH_BYTES
+        #define MEMM_PEAK_PUBLISH_BYTES 65536
+    #endif
+#else
+    #undef MEMM_PEAK_PUBLISH_BYTES
+    #define MEMM_PEAK_PUBLISH_BYTES 0
+#endif
+
+/// @brief compile-time validation that shard count is power of 2
+#if (MEMM_SHARD_COUNT & (MEMM_SHARD_COUNT - 1)) != 0
+    #error "MEMM_SHARD_COUNT must be a power of 2 for hashing efficiency"
+#endif
+
+/// @brief with MEMM_SAMPLING only about one allocation per MEMM_SAMPLE_INTERVAL bytes gets a tracking record, reports are scaled estimates
+#ifdef MEMM_SAMPLING
+    #ifdef MEMM_INLINE_HEADERS
+        #error "MEMM_SAMPLING relies on the pointer index, it can't be combined with MEMM_INLINE_HEADERS"
+    #endif
+    #ifndef MEMM_SAMPLE_INTERVAL
+        #define MEMM_SAMPLE_INTERVAL 524288
+    #endif
+#endif
+
+/// @brief with MEMM_SMALL_ALLOCATOR blocks up to MEMM_SMALL_MAX_SIZE bytes come from size-class slabs with per-thread caches instead of the system allocator
+#ifdef MEMM_SMALL_ALLOCATOR
+    /// @brief sets the largest request served by the size classes, every multiple of 16 up to it is a class
+    #ifndef MEMM_SMALL_MAX_SIZE
+        #define MEMM_SMALL_MAX_SIZE 1024
+    #endif
+    /// @brief sets the bytes of a slab page, every page holds blocks of a single size class
+    #ifndef MEMM_SMALL_PAGE_SIZE
+        #define MEMM_SMALL_PAGE_SIZE 65536
+    #endif
+    /// @brief sets the address space reserved for slab pages on first use, requests fall back to the system allocator once it is used up
+    #ifndef MEMM_SMALL_HEAP_SIZE
+        #define MEMM_SMALL_HEAP_SIZE ((size_t)1 << 30)
+    #endif
+    /// @brief sets the high-water mark of every per-thread cache in blocks, a cache reaching it hands half of its blocks back to the size class
+    #ifndef MEMM_SMALL_CACHE_SIZE
+        #define MEMM_SMALL_CACHE_SIZE 64
+    #endif
+    /// @brief sets the high-water mark of every per-thread cache in bytes, so caches of large size classes hold fewer blocks
+    #ifndef MEMM_SMALL_CACHE_BYTES
+        #define MEMM_SMALL_CACHE_BYTES 32768
+    #endif
+    #if MEMM_SMALL_MAX_SIZE % 16 != 0 || MEMM_SMALL_MAX_SIZE > MEMM_SMALL_PAGE_SIZE
+        #error "MEMM_SMALL_MAX_SIZE must be a multiple of 16 no larger than MEMM_SMALL_PAGE_SIZE"
+    #endif
+    #if (MEMM_SMALL_PAGE_SIZE & (MEMM_SMALL_PAGE_SIZE - 1)) != 0
+        #error "MEMM_SMALL_PAGE_SIZE must be a power of 2"
+    #endif
+    #if MEMM_SMALL_CACHE_SIZE < 2
+        #error "MEMM_SMALL_CACHE_SIZE must be at least 2"
+    #endif
+#endif
+
+/// @brief with MEMM_MMAP_THRESHOLD blocks of at least that many bytes are mapped straight from the os, and grown by remapping on linux
+/// with MEMM_MMAP_HUGEPAGES their mappings are rounded to 2 MiB and advised to use transparent huge pages
+#ifdef MEMM_MMAP_THRESHOLD
+    #if MEMM_MMAP_THRESHOLD < 1
+        #error "MEMM_MMAP_THRESHOLD must be positive"
+    #endif
+#endif
+
+/// @brief sets how many distinct (file, line) allocation sites can be interned, later ones are reported as unknown
+#ifndef MEMM_MAX_CALLSITES
+    #define MEMM_MAX_CALLSITES 65536
+#endif
+
+/// @brief pointer hash functions selectable with MEMM_HASH_FUNCTION
+#define MEMM_HASH_MASK 0      // low bits of the address, only for comparison since aligned pointers cluster
+#define MEMM_HASH_FIBONACCI 1 // multiplicative hashing keeping the high bits of ptr * 2^64/phi, a single multiplication
+#define MEMM_HASH_FMIX64 2    // murmur3 64-bit finalizer, best distribution for adversarial address patterns
+
+/// @brief sets the hash function used by the pointer index
+#ifndef MEMM_HASH_FUNCTION
+    #define MEMM_HASH_FUNCTION MEMM_HASH_FIBONACCI
+#endif
+
+/// @brief sets how many probe lengths memm_table_stats_t reports individually, the last entry accumulates longer ones
+#ifndef MEMM_PROBE_HISTOGRAM_SIZE
+    #define MEMM_PROBE_HISTOGRAM_SIZE 16
+#endif
+
+/// @brief clock sources selectable with MEMM_CLOCK_SOURCE
+#define MEMM_CLOCK_NONE 0     // allocations are not timestamped, saving the clock read and 8 bytes per record
+#define MEMM_CLOCK_CYCLES 1   // cpu cycle counter (rdtsc on x86, cntvct on arm64), a few cycles per read, calibrated to nanoseconds
+#define MEMM_CLOCK_COARSE 2   // CLOCK_MONOTONIC_COARSE (GetTickCount64 on windows), a vDSO read with scheduler tick resolution
+
+/// @brief sets the clock allocations are timestamped with, cycles fall back to coarse on other architectures
+#ifndef MEMM_CLOCK_SOURCE
+    #define MEMM_CLOCK_SOURCE MEMM_CLOCK_CYCLES
+#endif
+
+/// @brief sets how many log2 buckets the per-callsite lifetime histograms have, the last one accumulates longer lifetimes
+#ifndef MEMM_LIFETIME_BUCKETS
+    #define MEMM_LIFETIME_BUCKETS 48
+#endif
+
+/// @brief sets how many size classes every power of two is split into by the size histogram, as a power of 2
+#ifndef MEMM_SIZE_SUB_BUCKET_BITS
+    #define MEMM_SIZE_SUB_BUCKET_BITS 2
+#endif
+
+/// @brief sets the bit length of the largest size the size histogram tells apart, larger ones go to the last bucket
+#ifndef MEMM_SIZE_HISTOGRAM_BITS
+    #define MEMM_SIZE_HISTOGRAM_BITS 40
+#endif
+
+/// @brief size classes per power of two, and size classes overall: sizes below MEMM_SIZE_SUB_BUCKETS get one each
+#define MEMM_SIZE_SUB_BUCKETS (1 << MEMM_SIZE_SUB_BUCKET_BITS)
+#define MEMM_SIZE_BUCKETS ((MEMM_SIZE_HISTOGRAM_BITS - MEMM_SIZE_SUB_BUCKET_BITS + 1) << MEMM_SIZE_SUB_BUCKET_BITS)
+
+/// @brief sets how many bytes of report output are accumulated before handing them to a write callback
+#ifndef MEMM_REPORT_CHUNK_SIZE
+    #define MEMM_REPORT_CHUNK_SIZE 4096
+#endif
+
+/// @brief sets how many bytes an arena created with a chunk size of 0 reserves per chunk
+#ifndef MEMM_ARENA_CHUNK_SIZE
+    #define MEMM_ARENA_CHUNK_SIZE 65536
+#endif
+
+/// @brief sets the alignment of every block handed out by an arena
+#ifndef MEMM_ARENA_ALIGNMENT
+    #define MEMM_ARENA_ALIGNMENT 16
+#endif
+
+/// @brief compile-time validation that arena alignment is power of 2
+#if (MEMM_ARENA_ALIGNMENT & (MEMM_ARENA_ALIGNMENT - 1)) != 0
+    #error "MEMM_ARENA_ALIGNMENT must be a power of 2"
+#endif
+
+/// @brief sets how many objects are carved from each slab of a pool created with 0 objects per slab
+#ifndef MEMM_POOL_SLAB_SIZE
+    #define MEMM_POOL_SLAB_SIZE 256
+#endif
+
 /// @brief compilation options
 #if defined(MEMM_BUILD_SHARED) // shared library
     #if defined(_WIN32) || defined(_WIN64)
@@ -35,12 +194,130 @@
 extern "C" {
 #endif
 
+/// @brief how much memm tracks, settable at runtime with memm_set_level
+typedef enum memm_level
+{
+    MEMM_LEVEL_OFF = 0,             // blocks go straight to the allocator
+    MEMM_LEVEL_COUNTERS,            // global counters and size histogram only
+    MEMM_LEVEL_CALLSITES,           // plus per-callsite statistics
+    MEMM_LEVEL_FULL                 // plus a record per block, listed in the allocations and leak reports with its lifetime
+} memm_level_t;
+
+/// @brief statistics a top-N callsite report can be sorted by
+typedef enum memm_sort_key
+{
+    MEMM_SORT_LIVE_BYTES = 0,       // bytes currently alive
+    MEMM_SORT_LIVE_COUNT,           // blocks currently alive
+    MEMM_SORT_TOTAL_BYTES,          // bytes ever allocated
+    MEMM_SORT_CALL_COUNT,           // allocations ever made
+    MEMM_SORT_PEAK_BYTES,           // most bytes simultaneously alive
+    MEMM_SORT_FREED_COUNT           // blocks ever freed
+} memm_sort_key_t;
+
+/// @brief aggregate statistics of a callsite
+typedef struct memm_callsite_stats
+{
+    uint32_t callsite;              // id of the callsite, 0 if unknown
+    const char* file;
+    int line;
+    size_t live_count;              // blocks currently alive
+    size_t live_bytes;              // bytes currently alive
+    size_t total_bytes;             // bytes ever allocated
+    size_t call_count;              // allocations ever made
+    size_t peak_bytes;              // most bytes simultaneously alive
+} memm_callsite_stats_t;
+
+/// @brief lifetime distribution of the freed blocks of a callsite, bucket i counts lifetimes in [limits_ns[i - 1], limits_ns[i])
+typedef struct memm_lifetime_stats
+{
+    uint32_t callsite;              // id of the callsite, 0 if unknown
+    const char* file;
+    int line;
+    size_t freed_count;             // lifetimes recorded, the sum of every bucket
+    size_t counts[MEMM_LIFETIME_BUCKETS]; // freed blocks by lifetime, the last bucket includes longer ones
+    double limits_ns[MEMM_LIFETIME_BUCKETS]; // exclusive upper bound of every bucket, in nanoseconds
+} memm_lifetime_stats_t;
+
+/// @brief allocations by size class, bucket i counts sizes in [lower_bounds[i], lower_bounds[i + 1])
+typedef struct memm_size_histogram
+{
+    size_t allocation_count;        // allocations counted, the sum of every bucket
+    size_t counts[MEMM_SIZE_BUCKETS]; // allocations by size class, the last bucket includes larger ones
+    uint64_t lower_bounds[MEMM_SIZE_BUCKETS]; // smallest size of every bucket
+} memm_size_histogram_t;
+
+/// @brief distribution statistics of the pointer index
+typedef struct memm_table_stats
+{
+    size_t capacity;                // slots in the index
+    size_t entries;                 // live entries in the index
+    size_t draining_entries;        // live entries still waiting to be migrated from the previous table after a grow
+    size_t used_home_slots;         // slots that are the hash destination of at least one entry
+    double load_factor;             // entries / capacity
+    double home_slot_occupancy;     // used_home_slots / capacity, ideally close to the load factor
+    double average_chain_length;    // entries sharing a home slot, on average
+    size_t max_chain_length;        // most entries sharing a single home slot
+    double average_probe_length;    // slots between an entry and its home slot, on average
+    size_t max_probe_length;        // longest distance between an entry and its home slot
+    size_t probe_length_histogram[MEMM_PROBE_HISTOGRAM_SIZE]; // entries by distance to their home slot
+    const char* hash_function;      // name of the hash function in use
+} memm_table_stats_t;
+
+/// @brief bump allocator tracked as a whole, its blocks are released together by memm_arena_reset or memm_arena_destroy
+typedef struct memm_arena memm_arena_t;
+
+/// @brief statistics of an arena
+typedef struct memm_arena_stats
+{
+    uint32_t callsite;              // id of the callsite the arena was created at, 0 if unknown
+    const char* file;
+    int line;
+    size_t chunk_count;             // chunks reserved from the allocator
+    size_t reserved_bytes;          // bytes of every chunk, what the arena accounts in the global statistics
+    size_t used_bytes;              // bytes handed out since the last reset, including alignment padding
+    size_t object_count;            // blocks handed out since the last reset
+    size_t peak_used_bytes;         // most bytes handed out between two resets
+    size_t reset_count;             // times the arena was reset
+} memm_arena_stats_t;
+
+/// @brief fixed-size object pool tracked as a whole, its objects take no tracking record
+typedef struct memm_pool memm_pool_t;
+
+/// @brief statistics of a pool
+typedef struct memm_pool_stats
+{
+    uint32_t callsite;              // id of the callsite the pool was created at, 0 if unknown
+    const char* file;
+    int line;
+    size_t object_size;             // bytes per object, rounded up to a multiple of 16
+    size_t live_count;              // objects currently alive
+    size_t peak_count;              // most objects simultaneously alive
+    size_t capacity;                // objects the reserved slabs can hold
+    size_t slab_count;              // slabs reserved from the allocator
+    size_t reserved_bytes;          // bytes of every slab, what the pool accounts in the global statistics
+} memm_pool_stats_t;
+
+/// @brief receives report output in chunks of at most MEMM_REPORT_CHUNK_SIZE bytes, not NUL-terminated, return false to stop the report
+/// under MEMM_THREAD_SAFE it may be called with a shard lock held, so it must not allocate through memm
+typedef bool (*memm_write_fn)(void* user, const char* data, size_t size);
+
+/// @brief sets the tracking level blocks start with before memm_set_level is called
+#ifndef MEMM_DEFAULT_LEVEL
+    #define MEMM_DEFAULT_LEVEL MEMM_LEVEL_FULL
+#endif
+
 ///@brief initializes the memory manager
 MEMM_API void memm_init();
 
 /// @brief shutdows the memory manager
 MEMM_API void memm_shutdown();
 
+/// @brief changes how much new allocations are tracked, blocks keep the level they were allocated with until freed
+MEMM_API void memm_set_level(memm_level_t level);
+
+/// @brief returns the tracking level new allocations get
+MEMM_API memm_level_t memm_get_level();
+
 /// @brief allocates memory
 MEMM_API void* memm_malloc(size_t size, const char* file, int line);
 
@@ -53,7 +330,142 @@ MEMM_API void* memm_realloc(void* ptr, size_t size, const char* file, int line);
 /// @brief deallocates memory
 MEMM_API void memm_free(void* ptr, const char* file, int line);
 
-/// @brief returns how much of the memory is being currently used
+/// @brief deallocates memory whose size the caller knows, a size different from the allocated one is reported as an error
+MEMM_API void memm_free_sized(void* ptr, size_t size, const char* file, int line);
+
+/// @brief returns the id of an allocation site, interning it on first use, 0 is the unknown callsite
+MEMM_API uint32_t memm_intern_callsite(const char* file, int line);
+
+/// @brief resolves a callsite id back to its file and line, returns false for unknown ids
+MEMM_API bool memm_get_callsite(uint32_t callsite, const char** file, int* line);
+
+/// @brief fills-out the aggregate statistics of a callsite, returns false for unknown ids
+MEMM_API bool memm_get_callsite_stats(uint32_t callsite, memm_callsite_stats_t* stats);
+
+/// @brief fills-out the lifetime histogram of a callsite, returns false for unknown ids or when MEMM_CLOCK_SOURCE is MEMM_CLOCK_NONE
+MEMM_API bool memm_get_lifetime_stats(uint32_t callsite, memm_lifetime_stats_t* stats);
+
+/// @brief allocates memory on behalf of an interned callsite
+MEMM_API void* memm_malloc_at(size_t size, uint32_t callsite);
+
+/// @brief zeroed-allocates memory on behalf of an interned callsite
+MEMM_API void* memm_calloc_at(size_t num, size_t size, uint32_t callsite);
+
+/// @brief realocates memory on behalf of an interned callsite
+MEMM_API void* memm_realloc_at(void* ptr, size_t size, uint32_t callsite);
+
+/// @brief allocates memory aligned to a power of 2, released with memm_free like any other block, NULL with errno set to EINVAL for other alignments
+MEMM_API void* memm_aligned_alloc(size_t alignment, size_t size, const char* file, int line);
+
+/// @brief allocates aligned memory on behalf of an interned callsite
+MEMM_API void* memm_aligned_alloc_at(size_t alignment, size_t size, uint32_t callsite);
+
+/// @brief allocates memory aligned to alignment rounded up to a power of 2, like glibc memalign, NULL with errno set to EINVAL if there is none
+MEMM_API void* memm_memalign(size_t alignment, size_t size, const char* file, int line);
+
+/// @brief allocates memalign memory on behalf of an interned callsite
+MEMM_API void* memm_memalign_at(size_t alignment, size_t size, uint32_t callsite);
+
+/// @brief allocates aligned memory into out_ptr, returns 0, EINVAL if alignment isn't a power of 2 multiple of sizeof(void*) or ENOMEM
+MEMM_API int memm_posix_memalign(void** out_ptr, size_t alignment, size_t size, const char* file, int line);
+
+/// @brief allocates aligned memory into out_ptr on behalf of an interned callsite
+MEMM_API int memm_posix_memalign_at(void** out_ptr, size_t alignment, size_t size, uint32_t callsite);
+
+/// @brief allocates memory aligned to the page size
+MEMM_API void* memm_valloc(size_t size, const char* file, int line);
+
+/// @brief allocates page aligned memory on behalf of an interned callsite
+MEMM_API void* memm_valloc_at(size_t size, uint32_t callsite);
+
+/// @brief duplicates a string into a tracked block
+MEMM_API char* memm_strdup(const char* str, const char* file, int line);
+
+/// @brief duplicates a string on behalf of an interned callsite
+MEMM_API char* memm_strdup_at(const char* str, uint32_t callsite);
+
+/// @brief duplicates at most size characters of a string into a tracked block, always NUL-terminated
+MEMM_API char* memm_strndup(const char* str, size_t size, const char* file, int line);
+
+/// @brief duplicates at most size characters of a string on behalf of an interned callsite
+MEMM_API char* memm_strndup_at(const char* str, size_t size, uint32_t callsite);
+
+/// @brief realocates memory for num elements of size bytes, failing with ENOMEM instead of overflowing
+MEMM_API void* memm_reallocarray(void* ptr, size_t num, size_t size, const char* file, int line);
+
+/// @brief realocates an array on behalf of an interned callsite
+MEMM_API void* memm_reallocarray_at(void* ptr, size_t num, size_t size, uint32_t callsite);
+
+/// @brief prints into a tracked block stored in out, returns the length printed or -1 with out set to NULL
+MEMM_API int memm_asprintf(char** out, const char* file, int line, const char* format, ...);
+
+/// @brief prints into a tracked block on behalf of an interned callsite
+MEMM_API int memm_asprintf_at(char** out, uint32_t callsite, const char* format, ...);
+
+/// @brief prints a va_list into a tracked block stored in out
+MEMM_API int memm_vasprintf(char** out, const char* file, int line, const char* format, va_list args);
+
+/// @brief prints a va_list into a tracked block on behalf of an interned callsite
+MEMM_API int memm_vasprintf_at(char** out, uint32_t callsite, const char* format, va_list args);
+
+/// @brief reads a line into *lineptr, a tracked block of *size bytes grown as needed, returns its length or -1 at the end of the stream
+MEMM_API ptrdiff_t memm_getline(char** lineptr, size_t* size, FILE* stream, const char* file, int line);
+
+/// @brief reads a line on behalf of an interned callsite
+MEMM_API ptrdiff_t memm_getline_at(char** lineptr, size_t* size, FILE* stream, uint32_t callsite);
+
+/// @brief reads up to and including delimiter into *lineptr, like memm_getline
+MEMM_API ptrdiff_t memm_getdelim(char** lineptr, size_t* size, int delimiter, FILE* stream, const char* file, int line);
+
+/// @brief reads up to a delimiter on behalf of an interned callsite
+MEMM_API ptrdiff_t memm_getdelim_at(char** lineptr, size_t* size, int delimiter, FILE* stream, uint32_t callsite);
+
+/// @brief allocates count blocks of size bytes into out_ptrs under one callsite, amortizing the tracking across the batch, returns how many were allocated and nulls the rest
+MEMM_API size_t memm_malloc_batch(size_t size, size_t count, void** out_ptrs, const char* file, int line);
+
+/// @brief allocates a batch of blocks on behalf of an interned callsite
+MEMM_API size_t memm_malloc_batch_at(size_t size, size_t count, void** out_ptrs, uint32_t callsite);
+
+/// @brief deallocates count blocks, null pointers are skipped
+MEMM_API void memm_free_batch(void** ptrs, size_t count);
+
+/// @brief creates an arena reserving chunk_size bytes per chunk (MEMM_ARENA_CHUNK_SIZE when 0), the chunks are accounted to the callsite
+MEMM_API memm_arena_t* memm_arena_create(size_t chunk_size, const char* file, int line);
+
+/// @brief creates an arena on behalf of an interned callsite
+MEMM_API memm_arena_t* memm_arena_create_at(size_t chunk_size, uint32_t callsite);
+
+/// @brief bump-allocates size bytes aligned to MEMM_ARENA_ALIGNMENT, an arena must only be used by one thread at a time
+MEMM_API void* memm_arena_alloc(memm_arena_t* arena, size_t size);
+
+/// @brief releases every block of the arena in O(1), its chunks are kept and reused
+MEMM_API void memm_arena_reset(memm_arena_t* arena);
+
+/// @brief releases every block and chunk of the arena and the arena itself
+MEMM_API void memm_arena_destroy(memm_arena_t* arena);
+
+/// @brief fills-out the statistics of an arena
+MEMM_API bool memm_get_arena_stats(const memm_arena_t* arena, memm_arena_stats_t* stats);
+
+/// @brief creates a pool of object_size byte objects carved objects_per_slab at a time (MEMM_POOL_SLAB_SIZE when 0), the slabs are accounted to the callsite
+MEMM_API memm_pool_t* memm_pool_create(size_t object_size, size_t objects_per_slab, const char* file, int line);
+
+/// @brief creates a pool on behalf of an interned callsite
+MEMM_API memm_pool_t* memm_pool_create_at(size_t object_size, size_t objects_per_slab, uint32_t callsite);
+
+/// @brief takes an object from the pool in O(1), 16-byte aligned
+MEMM_API void* memm_pool_alloc(memm_pool_t* pool);
+
+/// @brief returns an object to the pool it was taken from in O(1)
+MEMM_API void memm_pool_free(memm_pool_t* pool, void* ptr);
+
+/// @brief releases every slab of the pool and the pool itself, live objects are reported as leaks
+MEMM_API void memm_pool_destroy(memm_pool_t* pool);
+
+/// @brief fills-out the statistics of a pool
+MEMM_API bool memm_get_pool_stats(const memm_pool_t* pool, memm_pool_stats_t* stats);
+
+/// @brief returns how much of the memory is being currently used, with MEMM_SAMPLING in usable bytes of the allocator
 MEMM_API size_t memm_get_current_usage();
 
 /// @brief returns the peak usage, wich is how much bytes were simultaneously allocated
@@ -65,6 +477,12 @@ MEMM_API size_t memm_get_allocation_count();
 /// @brief returns how may free calls were issued
 MEMM_API size_t memm_get_free_count();
 
+/// @brief fills-out how many allocations fell into every size class, power of two classes split into MEMM_SIZE_SUB_BUCKETS each
+MEMM_API bool memm_get_size_histogram(memm_size_histogram_t* histogram);
+
+/// @brief fills-out the distribution statistics of the pointer index, walks the whole index so avoid calling it on hot paths
+MEMM_API bool memm_get_table_stats(memm_table_stats_t* stats);
+
 /// @brief fills-out a buffer with statistics about the memory manager
 MEMM_API int memm_get_stats_string(char* buffer, size_t buffer_size);
 
@@ -74,45 +492,222 @@ MEMM_API int memm_get_allocations_string(char* buffer, size_t buffer_size);
 /// @brief fills-out a buffer with information about pottentially memory leaks
 MEMM_API int memm_get_leaks_string(char* buffer, size_t buffer_size);
 
+/// @brief fills-out a buffer with the n callsites with highest sort_key, in O(callsites) without scanning live allocations
+MEMM_API int memm_get_top_callsites_string(char* buffer, size_t buffer_size, size_t n, memm_sort_key_t sort_key);
+
+/// @brief fills-out a buffer with the lifetime percentiles and histograms of the n callsites that freed the most blocks
+MEMM_API int memm_get_lifetimes_string(char* buffer, size_t buffer_size, size_t n);
+
+/// @brief streams statistics about the memory manager to a write callback, returns false if it stopped early
+MEMM_API bool memm_write_stats(memm_write_fn write, void* user);
+
+/// @brief streams every current allocation to a write callback, without truncation, returns false if it stopped early
+MEMM_API bool memm_write_allocations(memm_write_fn write, void* user);
+
+/// @brief streams every pottential memory leak to a write callback, without truncation, returns false if it stopped early
+MEMM_API bool memm_write_leaks(memm_write_fn write, void* user);
+
+/// @brief streams the n callsites with highest sort_key to a write callback, returns false if it stopped early
+MEMM_API bool memm_write_top_callsites(memm_write_fn write, void* user, size_t n, memm_sort_key_t sort_key);
+
+/// @brief streams the lifetime percentiles and histograms of the n callsites that freed the most blocks, returns false if it stopped early
+MEMM_API bool memm_write_lifetimes(memm_write_fn write, void* user, size_t n);
+
+/// @brief write callback for a FILE*, passed as user
+MEMM_API bool memm_file_writer(void* file, const char* data, size_t size);
+
+/// @brief write callback for a file descriptor, passed as user with (void*)(intptr_t)fd, it doesn't go through stdio buffering
+MEMM_API bool memm_fd_writer(void* fd, const char* data, size_t size);
+
 /// @brief helper macros for stats, must have logging enable
 #ifdef MEMM_ENABLE_LOGGING
 
-/// @brief sets how many bytes the helper-macros string have at max, increase it if 2048 is not enough
+/// @brief kept for compatibility, the helper-macros stream their reports and are no longer limited by it
 #ifndef MEMM_MAX_STRING_LENGTH
     #define MEMM_MAX_STRING_LENGTH 2048
 #endif
 
 #define memm_print_stats() do { \
-    char _buf[MEMM_MAX_STRING_LENGTH]; \
-    if (memm_get_stats_string(_buf, sizeof(_buf)) > 0) printf("%s", _buf); \
+    memm_write_stats(memm_file_writer, stdout); \
 } while (0)
 
 #define memm_print_allocations() do { \
-    char _buf[MEMM_MAX_STRING_LENGTH]; \
-    if (memm_get_allocations_string(_buf, sizeof(_buf)) > 0) printf("%s", _buf); \
+    memm_write_allocations(memm_file_writer, stdout); \
 } while (0)
 
 #define memm_print_leaks() do { \
-    char _buf[MEMM_MAX_STRING_LENGTH]; \
-    if (memm_get_leaks_string(_buf, sizeof(_buf)) > 0) printf("%s", _buf); \
+    memm_write_leaks(memm_file_writer, stdout); \
+} while (0)
+
+#define memm_print_top_callsites(n, sort_key) do { \
+    memm_write_top_callsites(memm_file_writer, stdout, n, sort_key); \
+} while (0)
+
+#define memm_print_lifetimes(n) do { \
+    memm_write_lifetimes(memm_file_writer, stdout, n); \
 } while (0)
  #endif
 
 /// @brief re-defines memory functions to use the memm, keeping track of memory allocations
 #ifndef MEMM_DONT_OVERRIDE_STD
     #include <stdlib.h>
+    #include <string.h>
+    #if defined(__GLIBC__)
+        // declares memalign, which would be mangled by the macros if it was included after them
+        #include <malloc.h>
+    #endif
     #undef malloc
     #undef calloc
     #undef realloc
     #undef free
-    #define malloc(size) memm_malloc(size, __FILE__, __LINE__)
-    #define calloc(num, size) memm_calloc(num, size, __FILE__, __LINE__)
-    #define realloc(ptr, size) memm_realloc(ptr, size, __FILE__, __LINE__)
+    #undef free_sized
+    #undef aligned_alloc
+    #undef posix_memalign
+    #undef memalign
+    #undef valloc
+    #undef strdup
+    #undef strndup
+    #undef reallocarray
+    #undef asprintf
+    #undef vasprintf
+    #undef getline
+    #undef getdelim
+    #if defined(__GNUC__) || defined(__clang__)
+        // a function-local static per expansion interns every callsite once instead of on every call, published with release so the callsite it names is visible to other threads
+        #define MEMM_CALLSITE() (__extension__({ \
+            static uint32_t _memm_callsite = 0; \
+            uint32_t _memm_id = __atomic_load_n(&_memm_callsite, __ATOMIC_ACQUIRE); \
+            if (!_memm_id) __atomic_store_n(&_memm_callsite, _memm_id = memm_intern_callsite(__FILE__, __LINE__), __ATOMIC_RELEASE); \
+            _memm_id; \
+        }))
+        #define malloc(size) memm_malloc_at(size, MEMM_CALLSITE())
+        #define calloc(num, size) memm_calloc_at(num, size, MEMM_CALLSITE())
+        #define realloc(ptr, size) memm_realloc_at(ptr, size, MEMM_CALLSITE())
+        #define aligned_alloc(alignment, size) memm_aligned_alloc_at(alignment, size, MEMM_CALLSITE())
+        #define posix_memalign(out_ptr, alignment, size) memm_posix_memalign_at(out_ptr, alignment, size, MEMM_CALLSITE())
+        #define memalign(alignment, size) memm_memalign_at(alignment, size, MEMM_CALLSITE())
+        #define valloc(size) memm_valloc_at(size, MEMM_CALLSITE())
+        #define strdup(str) memm_strdup_at(str, MEMM_CALLSITE())
+        #define strndup(str, size) memm_strndup_at(str, size, MEMM_CALLSITE())
+        #define reallocarray(ptr, num, size) memm_reallocarray_at(ptr, num, size, MEMM_CALLSITE())
+        #define asprintf(out, ...) memm_asprintf_at(out, MEMM_CALLSITE(), __VA_ARGS__)
+        #define vasprintf(out, format, args) memm_vasprintf_at(out, MEMM_CALLSITE(), format, args)
+        #ifndef __cplusplus
+        #define getline(lineptr, size, stream) memm_getline_at(lineptr, size, stream, MEMM_CALLSITE())
+        #define getdelim(lineptr, size, delimiter, stream) memm_getdelim_at(lineptr, size, delimiter, stream, MEMM_CALLSITE())
+        #endif
+    #else
+        #define malloc(size) memm_malloc(size, __FILE__, __LINE__)
+        #define calloc(num, size) memm_calloc(num, size, __FILE__, __LINE__)
+        #define realloc(ptr, size) memm_realloc(ptr, size, __FILE__, __LINE__)
+        #define aligned_alloc(alignment, size) memm_aligned_alloc(alignment, size, __FILE__, __LINE__)
+        #define posix_memalign(out_ptr, alignment, size) memm_posix_memalign(out_ptr, alignment, size, __FILE__, __LINE__)
+        #define memalign(alignment, size) memm_memalign(alignment, size, __FILE__, __LINE__)
+        #define valloc(size) memm_valloc(size, __FILE__, __LINE__)
+        #define strdup(str) memm_strdup(str, __FILE__, __LINE__)
+        #define strndup(str, size) memm_strndup(str, size, __FILE__, __LINE__)
+        #define reallocarray(ptr, num, size) memm_reallocarray(ptr, num, size, __FILE__, __LINE__)
+        #define asprintf(out, ...) memm_asprintf(out, __FILE__, __LINE__, __VA_ARGS__)
+        #define vasprintf(out, format, args) memm_vasprintf(out, __FILE__, __LINE__, format, args)
+        #ifndef __cplusplus
+        #define getline(lineptr, size, stream) memm_getline(lineptr, size, stream, __FILE__, __LINE__)
+        #define getdelim(lineptr, size, delimiter, stream) memm_getdelim(lineptr, size, delimiter, stream, __FILE__, __LINE__)
+        #endif
+    #endif
     #define free(ptr) memm_free(ptr, __FILE__, __LINE__)
+    #define free_sized(ptr, size) memm_free_sized(ptr, size, __FILE__, __LINE__)
 #endif
 
 #ifdef __cplusplus
 }
 #endif
 
+/// @brief routes the global operator new/delete through memm, define it in exactly one c++ translation unit before including memm.h
+#if defined(__cplusplus) && defined(MEMM_CXX_OPERATORS)
+    #include <new>
+
+    /// @brief callsite every operator new is attributed to, c++ allocations carry no file and line
+    static uint32_t memm_cxx_callsite()
+    {
+        static uint32_t callsite = memm_intern_callsite("operator new", 0);
+        return callsite;
+    }
+
+    void* operator new(std::size_t size)
+    {
+        void* ptr = memm_malloc_at(size ? size : 1, memm_cxx_callsite());
+        if (!ptr) throw std::bad_alloc();
+        return ptr;
+    }
+
+    void* operator new[](std::size_t size)
+    {
+        void* ptr = memm_malloc_at(size ? size : 1, memm_cxx_callsite());
+        if (!ptr) throw std::bad_alloc();
+        return ptr;
+    }
+
+    void operator delete(void* ptr) noexcept
+    {
+        memm_free(ptr, "operator delete", 0);
+    }
+
+    void operator delete[](void* ptr) noexcept
+    {
+        memm_free(ptr, "operator delete[]", 0);
+    }
+
+    #if defined(__cpp_aligned_new)
+    // over-aligned types come through here, their blocks are released by memm_free like every other
+    void* operator new(std::size_t size, std::align_val_t alignment)
+    {
+        void* ptr = memm_aligned_alloc_at(static_cast<std::size_t>(alignment), size ? size : 1, memm_cxx_callsite());
+        if (!ptr) throw std::bad_alloc();
+        return ptr;
+    }
+
+    void* operator new[](std::size_t size, std::align_val_t alignment)
+    {
+        void* ptr = memm_aligned_alloc_at(static_cast<std::size_t>(alignment), size ? size : 1, memm_cxx_callsite());
+        if (!ptr) throw std::bad_alloc();
+        return ptr;
+    }
+
+    void operator delete(void* ptr, std::align_val_t) noexcept
+    {
+        memm_free(ptr, "operator delete", 0);
+    }
+
+    void operator delete[](void* ptr, std::align_val_t) noexcept
+    {
+        memm_free(ptr, "operator delete[]", 0);
+    }
+
+    #if defined(__cpp_sized_deallocation)
+    void operator delete(void* ptr, std::size_t size, std::align_val_t) noexcept
+    {
+        memm_free_sized(ptr, size ? size : 1, "operator delete", 0);
+    }
+
+    void operator delete[](void* ptr, std::size_t size, std::align_val_t) noexcept
+    {
+        memm_free_sized(ptr, size ? size : 1, "operator delete[]", 0);
+    }
+    #endif
+    #endif
+
+    #if defined(__cpp_sized_deallocation)
+    // the size a sized delete gets is the one operator new was called with, zero-sized objects were allocated as 1 byte
+    void operator delete(void* ptr, std::size_t size) noexcept
+    {
+        memm_free_sized(ptr, size ? size : 1, "operator delete", 0);
+    }
+
+    void operator delete[](void* ptr, std::size_t size) noexcept
+    {
+        memm_free_sized(ptr, size ? size : 1, "operator delete[]", 0);
+    }
+    #endif
+#endif
+
 #endif // MEMM_HEADER_INCLUDED
\ No newline at end of file
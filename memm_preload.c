@@ -0,0 +1,388 @@
+/// @brief LD_PRELOAD build of memm, tracks the allocations of any dynamically linked program on linux without rebuilding it
+/// cc -shared -fPIC -O2 memm_preload.c -o libmemm_preload.so -ldl -lpthread -lm
+/// MEMM_REPORT_FILE=memm.txt MEMM_REPORT=stats,leaks LD_PRELOAD=./libmemm_preload.so ./program
+#if !defined(__linux__)
+    #error "memm_preload.c relies on symbol interposition and dlsym(RTLD_NEXT), it only builds on linux"
+#endif
+
+#if defined(MEMM_INLINE_HEADERS) || defined(MEMM_SMALL_ALLOCATOR) || defined(MEMM_MMAP_THRESHOLD)
+    #error "the preloaded allocator must hand out blocks of the system allocator, foreign code may pass them to malloc_usable_size"
+#endif
+
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+#define MEMM_DONT_OVERRIDE_STD
+#define MEMM_PRELOAD
+#ifndef MEMM_THREAD_SAFE
+    #define MEMM_THREAD_SAFE    // any program may be multi-threaded
+#endif
+#include "memm.c"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+
+/// @brief bytes served to allocations made while the next allocator is being resolved, dlsym itself may allocate
+#define MEMM_PRELOAD_BOOTSTRAP_SIZE 65536
+
+/// @brief bytes before every bootstrap block, holding its size
+#define MEMM_PRELOAD_BOOTSTRAP_HEADER 16
+
+/// @brief how many callsites the top callsites and lifetimes reports list
+#define MEMM_PRELOAD_REPORT_COUNT 10
+
+/// @brief progress of the resolution of the next allocator
+#define MEMM_PRELOAD_UNRESOLVED 0
+#define MEMM_PRELOAD_RESOLVING 1
+#define MEMM_PRELOAD_READY 2
+
+/// @brief the callsite every interposed entry point attributes its blocks to, preloaded code carries no file and line
+typedef enum memm_preload_site
+{
+    MEMM_PRELOAD_MALLOC = 0,
+    MEMM_PRELOAD_CALLOC,
+    MEMM_PRELOAD_REALLOC,
+    MEMM_PRELOAD_ALIGNED_ALLOC,
+    MEMM_PRELOAD_POSIX_MEMALIGN,
+    MEMM_PRELOAD_MEMALIGN,
+    MEMM_PRELOAD_VALLOC,
+    MEMM_PRELOAD_SITES
+} memm_preload_site_t;
+
+/// @brief the allocator next in the link chain, which memm sits on
+typedef struct memm_preload
+{
+    void* (*malloc)(size_t);
+    void* (*calloc)(size_t, size_t);
+    void* (*realloc)(void*, size_t);
+    void (*free)(void*);
+    int (*posix_memalign)(void**, size_t, size_t);
+    size_t state;                           // MEMM_PRELOAD_UNRESOLVED, MEMM_PRELOAD_RESOLVING or MEMM_PRELOAD_READY
+    uint32_t callsites[MEMM_PRELOAD_SITES];
+    int report_fd;                          // where the reports go, -1 for nowhere, taken at startup since programs may close stderr before exit
+} memm_preload_t;
+
+/// @brief the next allocator
+static memm_preload_t g_memm_preload;
+
+/// @brief blocks handed out before the next allocator is known, never released
+static _Alignas(16) char g_memm_preload_bootstrap[MEMM_PRELOAD_BOOTSTRAP_SIZE];
+
+/// @brief bytes of the bootstrap buffer handed out so far
+static size_t g_memm_preload_bootstrap_used;
+
+/// @brief set while a thread runs memm code, allocations it makes go straight to the next allocator instead of recursing
+static __thread int t_memm_preload_busy __attribute__((tls_model("initial-exec")));
+
+static void* memm_libc_malloc(size_t size)
+{
+    return g_memm_preload.malloc(size);
+}
+
+static void* memm_libc_calloc(size_t num, size_t size)
+{
+    return g_memm_preload.calloc(num, size);
+}
+
+static void* memm_libc_realloc(void* ptr, size_t size)
+{
+    return g_memm_preload.realloc(ptr, size);
+}
+
+static void memm_libc_free(void* ptr)
+{
+    g_memm_preload.free(ptr);
+}
+
+static int memm_libc_posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    return g_memm_preload.posix_memalign(ptr, alignment, size);
+}
+
+/// @brief writes a message straight to stderr, stdio may allocate
+static void memm_preload_log(const char* message)
+{
+    ssize_t written = write(2, message, strlen(message));
+    (void)written;
+}
+
+/// @brief carves a zeroed block from the bootstrap buffer, NULL once it is used up
+static void* memm_preload_bootstrap_alloc(size_t size)
+{
+    if (size > MEMM_PRELOAD_BOOTSTRAP_SIZE) return NULL;
+
+    size_t rounded = MEMM_PRELOAD_BOOTSTRAP_HEADER + ((size + 15) & ~(size_t)15);
+    size_t offset = memm_atomic_add(&g_memm_preload_bootstrap_used, rounded);
+    if (offset + rounded > MEMM_PRELOAD_BOOTSTRAP_SIZE) return NULL;
+
+    char* block = g_memm_preload_bootstrap + offset;
+    *(size_t*)block = size;
+    return block + MEMM_PRELOAD_BOOTSTRAP_HEADER;
+}
+
+/// @brief returns whether a block was carved from the bootstrap buffer
+static bool memm_preload_is_bootstrap(const void* ptr)
+{
+    return (const char*)ptr >= g_memm_preload_bootstrap && (const char*)ptr < g_memm_preload_bootstrap + MEMM_PRELOAD_BOOTSTRAP_SIZE;
+}
+
+/// @brief returns whether a comma-separated list contains a word
+static bool memm_preload_has(const char* list, const char* word)
+{
+    size_t length = strlen(word);
+    for (const char* item = list; item; item = strchr(item, ',')) {
+        if (*item == ',') item++;
+        if (strncmp(item, word, length) == 0 && (item[length] == ',' || item[length] == '\0')) return true;
+    }
+    return false;
+}
+
+/// @brief opens the descriptor the reports go to, MEMM_REPORT_FILE or a duplicate of stderr that outlives the program closing it, -1 for no reports
+static int memm_preload_report_open()
+{
+    const char* reports = getenv("MEMM_REPORT");
+    if (reports && strcmp(reports, "none") == 0) return -1;
+
+    // appended to, so every process of a preloaded tree adds its reports
+    const char* path = getenv("MEMM_REPORT_FILE");
+    if (path && *path) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd >= 0) return fd;
+        memm_preload_log("MEMM-WARN: MEMM_REPORT_FILE can't be opened, reporting to stderr\n");
+    }
+    return fcntl(2, F_DUPFD_CLOEXEC, 3);
+}
+
+/// @brief resolves the next allocator and starts memm, returns false while it isn't ready, allocations are then bootstrapped
+/// @brief takes every memm lock before fork, outer locks first as the library nests them, so the child never inherits one held by a thread that isn't there
+static void memm_preload_fork_prepare()
+{
+    memm_lock_acquire(&g_memm_arenas.lock);
+    memm_lock_acquire(&g_memm_pools.lock);
+    for (memm_pool_t* pool = g_memm_pools.head; pool; pool = pool->next) {
+        memm_lock_acquire(&pool->lock);
+    }
+    for (size_t i = 0; i < MEMM_SHARD_COUNT; i++) {
+        memm_lock_acquire(&g_memm.shards[i].lock);
+    }
+    memm_lock_acquire(&g_memm_callsites.lock);
+    memm_lock_acquire(&g_memm_registry.lock);
+}
+
+/// @brief releases the locks memm_preload_fork_prepare took, in the parent and in the child alike
+static void memm_preload_fork_release()
+{
+    memm_lock_release(&g_memm_registry.lock);
+    memm_lock_release(&g_memm_callsites.lock);
+    for (size_t i = MEMM_SHARD_COUNT; i > 0; i--) {
+        memm_lock_release(&g_memm.shards[i - 1].lock);
+    }
+    for (memm_pool_t* pool = g_memm_pools.head; pool; pool = pool->next) {
+        memm_lock_release(&pool->lock);
+    }
+    memm_lock_release(&g_memm_pools.lock);
+    memm_lock_release(&g_memm_arenas.lock);
+}
+
+static bool memm_preload_ready()
+{
+    if (memm_atomic_load_acquire(&g_memm_preload.state) == MEMM_PRELOAD_READY) return true;
+
+    // dlsym allocating on this thread, or another thread resolving, both get bootstrap blocks meanwhile
+    size_t expected = MEMM_PRELOAD_UNRESOLVED;
+    if (!memm_atomic_cas(&g_memm_preload.state, expected, MEMM_PRELOAD_RESOLVING)) return false;
+
+    // the object to function pointer conversion dlsym requires, spelled the way posix recommends
+    *(void**)&g_memm_preload.malloc = dlsym(RTLD_NEXT, "malloc");
+    *(void**)&g_memm_preload.calloc = dlsym(RTLD_NEXT, "calloc");
+    *(void**)&g_memm_preload.realloc = dlsym(RTLD_NEXT, "realloc");
+    *(void**)&g_memm_preload.free = dlsym(RTLD_NEXT, "free");
+    *(void**)&g_memm_preload.posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    if (!g_memm_preload.malloc || !g_memm_preload.calloc || !g_memm_preload.realloc || !g_memm_preload.free || !g_memm_preload.posix_memalign) {
+        memm_preload_log("MEMM-ERROR: libmemm_preload.so found no allocator to interpose\n");
+        abort();
+    }
+
+    t_memm_preload_busy++;
+    memm_init();
+
+    const char* level = getenv("MEMM_LEVEL");
+    if (level) {
+        if (strcmp(level, "off") == 0) memm_set_level(MEMM_LEVEL_OFF);
+        else if (strcmp(level, "counters") == 0) memm_set_level(MEMM_LEVEL_COUNTERS);
+        else if (strcmp(level, "callsites") == 0) memm_set_level(MEMM_LEVEL_CALLSITES);
+        else if (strcmp(level, "full") == 0) memm_set_level(MEMM_LEVEL_FULL);
+        else memm_preload_log("MEMM-WARN: MEMM_LEVEL must be off, counters, callsites or full\n");
+    }
+
+    const char* names[MEMM_PRELOAD_SITES] = { "malloc", "calloc", "realloc", "aligned_alloc", "posix_memalign", "memalign", "valloc" };
+    for (size_t i = 0; i < MEMM_PRELOAD_SITES; i++) {
+        g_memm_preload.callsites[i] = memm_intern_callsite(names[i], 0);
+    }
+    g_memm_preload.report_fd = memm_preload_report_open();
+
+    // a fork while another thread holds a memm lock would leave it held forever in the child
+    if (pthread_atfork(memm_preload_fork_prepare, memm_preload_fork_release, memm_preload_fork_release) != 0) {
+        memm_preload_log("MEMM-WARN: libmemm_preload.so couldn't register its fork handlers, a child forked while memm is busy may deadlock\n");
+    }
+    t_memm_preload_busy--;
+
+    memm_atomic_store_release(&g_memm_preload.state, MEMM_PRELOAD_READY);
+    return true;
+}
+
+/// @brief writes the reports MEMM_REPORT lists to the descriptor opened at startup, when the library is unloaded at exit
+static void memm_preload_report()
+{
+    if (memm_atomic_load_acquire(&g_memm_preload.state) != MEMM_PRELOAD_READY) return;
+
+    int fd = g_memm_preload.report_fd;
+    if (fd < 0) return;
+
+    const char* reports = getenv("MEMM_REPORT");
+    if (!reports) reports = "stats";
+
+    t_memm_preload_busy++;
+    void* user = (void*)(intptr_t)fd;
+    if (memm_preload_has(reports, "stats")) memm_write_stats(memm_fd_writer, user);
+    if (memm_preload_has(reports, "allocations")) memm_write_allocations(memm_fd_writer, user);
+    if (memm_preload_has(reports, "leaks")) memm_write_leaks(memm_fd_writer, user);
+    if (memm_preload_has(reports, "top")) memm_write_top_callsites(memm_fd_writer, user, MEMM_PRELOAD_REPORT_COUNT, MEMM_SORT_LIVE_BYTES);
+    if (memm_preload_has(reports, "lifetimes")) memm_write_lifetimes(memm_fd_writer, user, MEMM_PRELOAD_REPORT_COUNT);
+    t_memm_preload_busy--;
+    close(fd);
+}
+
+/// @brief resolves the next allocator before main, in case nothing allocated earlier
+__attribute__((constructor)) static void memm_preload_init()
+{
+    memm_preload_ready();
+}
+
+/// @brief reports when the program exits, after the destructors of everything loaded later
+__attribute__((destructor)) static void memm_preload_exit()
+{
+    memm_preload_report();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////// Interposed Functions
+
+void* malloc(size_t size)
+{
+    if (!memm_preload_ready()) return memm_preload_bootstrap_alloc(size);
+    if (t_memm_preload_busy) return g_memm_preload.malloc(size);
+
+    t_memm_preload_busy++;
+    void* ptr = memm_malloc_at(size, g_memm_preload.callsites[MEMM_PRELOAD_MALLOC]);
+    t_memm_preload_busy--;
+    return ptr;
+}
+
+void* calloc(size_t num, size_t size)
+{
+    if (!memm_preload_ready()) {
+        return size != 0 && num > (size_t)-1 / size ? NULL : memm_preload_bootstrap_alloc(num * size);
+    }
+    if (t_memm_preload_busy) return g_memm_preload.calloc(num, size);
+
+    t_memm_preload_busy++;
+    void* ptr = memm_calloc_at(num, size, g_memm_preload.callsites[MEMM_PRELOAD_CALLOC]);
+    t_memm_preload_busy--;
+    return ptr;
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    // bootstrap blocks move out to a regular one, the buffer is never reused
+    if (ptr && memm_preload_is_bootstrap(ptr)) {
+        size_t old_size = *(size_t*)((char*)ptr - MEMM_PRELOAD_BOOTSTRAP_HEADER);
+        void* new_ptr = malloc(size);
+        if (new_ptr) {
+            memcpy(new_ptr, ptr, size < old_size ? size : old_size);
+        }
+        return new_ptr;
+    }
+
+    if (!memm_preload_ready()) return ptr ? NULL : memm_preload_bootstrap_alloc(size);
+    if (t_memm_preload_busy) return g_memm_preload.realloc(ptr, size);
+
+    t_memm_preload_busy++;
+    void* new_ptr = memm_realloc_at(ptr, size, g_memm_preload.callsites[MEMM_PRELOAD_REALLOC]);
+    t_memm_preload_busy--;
+    return new_ptr;
+}
+
+void free(void* ptr)
+{
+    if (!ptr || memm_preload_is_bootstrap(ptr)) return;
+    if (t_memm_preload_busy) {
+        g_memm_preload.free(ptr);
+        return;
+    }
+
+    t_memm_preload_busy++;
+    memm_free(ptr, "free", 0);
+    t_memm_preload_busy--;
+}
+
+int posix_memalign(void** out_ptr, size_t alignment, size_t size)
+{
+    if (!memm_preload_ready()) return ENOMEM;
+    if (t_memm_preload_busy) return g_memm_preload.posix_memalign(out_ptr, alignment, size);
+
+    t_memm_preload_busy++;
+    int result = memm_posix_memalign_at(out_ptr, alignment, size, g_memm_preload.callsites[MEMM_PRELOAD_POSIX_MEMALIGN]);
+    t_memm_preload_busy--;
+    return result;
+}
+
+/// @brief serves aligned_alloc, memalign, valloc and pvalloc on behalf of a callsite, aligned_alloc rejects alignments that aren't a power of 2 while the others round them up like glibc
+static void* memm_preload_aligned_alloc(size_t alignment, size_t size, memm_preload_site_t site)
+{
+    if (!memm_preload_ready()) return NULL;
+    if (t_memm_preload_busy) {
+        void* ptr = NULL;
+        int result = g_memm_preload.posix_memalign(&ptr, alignment < sizeof(void*) ? sizeof(void*) : alignment, size);
+        if (result != 0) {
+            errno = result;
+            return NULL;
+        }
+        return ptr;
+    }
+
+    t_memm_preload_busy++;
+    void* ptr = site == MEMM_PRELOAD_ALIGNED_ALLOC ? memm_aligned_alloc_at(alignment, size, g_memm_preload.callsites[site]) : memm_memalign_at(alignment, size, g_memm_preload.callsites[site]);
+    t_memm_preload_busy--;
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memm_preload_aligned_alloc(alignment, size, MEMM_PRELOAD_ALIGNED_ALLOC);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    return memm_preload_aligned_alloc(alignment, size, MEMM_PRELOAD_MEMALIGN);
+}
+
+void* valloc(size_t size)
+{
+    return memm_preload_aligned_alloc((size_t)sysconf(_SC_PAGESIZE), size, MEMM_PRELOAD_VALLOC);
+}
+
+void* pvalloc(size_t size)
+{
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    if (size > (size_t)-1 - page_size) return NULL;
+    return memm_preload_aligned_alloc(page_size, (size + page_size - 1) & ~(page_size - 1), MEMM_PRELOAD_VALLOC);
+}
+
+void* reallocarray(void* ptr, size_t num, size_t size)
+{
+    if (size != 0 && num > (size_t)-1 / size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, num * size);
+}